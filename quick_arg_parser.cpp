@@ -0,0 +1,27 @@
+// Compile this into the program if QUICK_ARG_PARSER_SEPARATE_COMPILATION is defined
+#ifndef QUICK_ARG_PARSER_SEPARATE_COMPILATION
+#define QUICK_ARG_PARSER_SEPARATE_COMPILATION
+#endif
+#define QUICK_ARG_PARSER_IMPLEMENTATION
+#include "quick_arg_parser.hpp"
+
+namespace QuickArgParserInternals {
+
+template struct ArgConverter<int>;
+template struct ArgConverter<long int>;
+template struct ArgConverter<unsigned int>;
+template struct ArgConverter<float>;
+template struct ArgConverter<double>;
+template struct ArgConverter<std::vector<int>>;
+template struct ArgConverter<std::vector<std::string>>;
+template struct Demultiplexer<int>;
+template struct Demultiplexer<long int>;
+template struct Demultiplexer<unsigned int>;
+template struct Demultiplexer<float>;
+template struct Demultiplexer<double>;
+template struct Demultiplexer<std::string>;
+template struct Demultiplexer<std::vector<int>>;
+template struct Demultiplexer<std::vector<std::string>>;
+template class CacheIndex<>;
+
+} // namespace
@@ -1,13 +1,76 @@
-#include <iostream>
+#include <string>
 #include <vector>
-#include <sstream>
 #include <memory>
 #include <array>
 #include <unordered_map>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#if !defined(__GNUC__) && !defined(__clang__)
+#include <atomic>
+#endif
+
+// Define QUICK_ARG_PARSER_SEPARATE_COMPILATION in all translation units and compile quick_arg_parser.cpp
+// into the program to have the non-template parts compiled only once
+#ifdef QUICK_ARG_PARSER_SEPARATE_COMPILATION
+#define QUICK_ARG_PARSER_FUNCTION
+#else
+#define QUICK_ARG_PARSER_FUNCTION inline
+#endif
+
+// Define QUICK_ARG_PARSER_NO_IOSTREAM to print help and version through write() instead of std::cout
+#if !defined(QUICK_ARG_PARSER_SEPARATE_COMPILATION) || defined(QUICK_ARG_PARSER_IMPLEMENTATION)
+#include <algorithm>
+#include <list>
+#include <cstdio>
+#include <cctype>
+#ifdef QUICK_ARG_PARSER_NO_IOSTREAM
+#include <cerrno>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+#else
+#include <iostream>
+#endif
+#if defined(__APPLE__)
+#include <crt_externs.h>
+#elif !defined(_WIN32)
+extern "C" {
+extern char** environ;
+}
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define QUICK_ARG_PARSER_SSE2
+#include <emmintrin.h>
+#endif
+#endif
 
 #if __cplusplus > 201402L
+// Separate compilation leaves out <filesystem> because it's costly to compile, paths can be parsed if it's included first
+#ifndef QUICK_ARG_PARSER_SEPARATE_COMPILATION
 #include <filesystem>
+#endif
 #include <optional>
+#include <string_view>
+#endif
+
+// Define QUICK_ARG_PARSER_THREADS to enable the facilities that need threads
+#ifdef QUICK_ARG_PARSER_THREADS
+#include <atomic>
+#include <functional>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
 #endif
 
 namespace QuickArgParserInternals {
@@ -16,6 +79,19 @@ struct ArgumentError : std::runtime_error {
 	using std::runtime_error::runtime_error;
 };
 
+// Thrown if the input exceeds the ParsingLimits
+struct LimitError : ArgumentError {
+	using ArgumentError::ArgumentError;
+};
+
+// Bounds the work done when parsing untrusted input, zero means unlimited
+struct ParsingLimits {
+	size_t maxTokens = 0; // Not counting the program name
+	size_t maxTokenLength = 0;
+	size_t maxTotalBytes = 0;
+	size_t maxListElements = 0; // Total count of comma separated elements of a vector, map or set of flags
+};
+
 template <typename T, typename SFINAE = void>
 struct ArgConverter {
 	constexpr static bool canDo = false;
@@ -213,50 +289,341 @@ struct ArgConverter<Optional<T>, void> {
 	constexpr static bool canDo = true;
 };
 
-#if __cplusplus > 201402L
-template <>
-struct ArgConverter<std::filesystem::path, void> {
-	static std::filesystem::path makeDefault() {
+// Recognises std::filesystem::path and similar types by their interface, so <filesystem> doesn't have to be included
+template <typename T, typename SFINAE = void>
+struct IsPath : std::false_type {};
+
+template <typename T>
+struct IsPath<T, typename std::enable_if<std::is_same<decltype(T::preferred_separator), const typename T::value_type>::value
+		&& std::is_same<decltype(std::declval<const T&>().string()), std::string>::value>::type> : std::true_type {};
+
+template <typename T>
+struct ArgConverter<T, typename std::enable_if<IsPath<T>::value>::type> {
+	static T makeDefault() {
+		return {};
+	}
+	static T deserialise(const std::string& from) {
+		return T(from);
+	}
+	constexpr static bool canDo = true;
+};
+
+// Used by the enum converters, names has count elements
+QUICK_ARG_PARSER_FUNCTION std::string enumChoices(const char* const* names, size_t count);
+QUICK_ARG_PARSER_FUNCTION ArgumentError invalidEnumValue(const char* value, size_t length, const char* const* names, size_t count);
+
+#if __cplusplus >= 201402L
+template <typename T>
+struct EnumName {
+	const char* name;
+	T value;
+};
+
+// Specialise this with a method static constexpr std::array<EnumName<T>, N> names() to allow parsing an enum
+template <typename T, typename SFINAE = void>
+struct EnumNames {};
+
+template <typename T, typename SFINAE = void>
+struct HasEnumNames : std::false_type {};
+
+template <typename T>
+struct HasEnumNames<T, typename std::enable_if<std::is_enum<T>::value
+		&& !std::is_void<decltype(EnumNames<T>::names())>::value>::type> : std::true_type {};
+
+constexpr uint32_t enumNameHash(const char* name, size_t length, uint32_t seed) {
+	uint32_t hash = 2166136261u ^ (seed * 2654435769u);
+	for (size_t i = 0; i < length; i++) {
+		hash ^= uint8_t(name[i]);
+		hash *= 16777619u;
+	}
+	hash ^= hash >> 15;
+	hash *= 2246822519u;
+	return hash ^ (hash >> 13);
+}
+
+constexpr size_t powerOfTwoAtLeast(size_t value) {
+	size_t power = 1;
+	while (power < value)
+		power <<= 1;
+	return power;
+}
+
+// Hash and displace: names are split into buckets by one hash, each bucket gets a seed for a second hash
+// that places its names into empty slots
+template <size_t Count>
+struct PerfectHashTable {
+	constexpr static size_t buckets = powerOfTwoAtLeast(Count);
+	constexpr static size_t slots = powerOfTwoAtLeast(Count * 2);
+	uint32_t seeds[buckets];
+	uint16_t entries[slots]; // Index of the name plus one, zero means empty
+	uint16_t lengths[Count];
+	const char* names[Count];
+};
+
+template <typename Names, size_t Count = std::tuple_size<Names>::value>
+constexpr PerfectHashTable<Count> makePerfectHashTable(const Names& names) {
+	using Table = PerfectHashTable<Count>;
+	Table made{};
+	uint16_t bucketOf[Count] = {};
+	size_t bucketSizes[Table::buckets] = {};
+	for (size_t i = 0; i < Count; i++) {
+		made.names[i] = names[i].name;
+		while (names[i].name[made.lengths[i]] != '\0')
+			made.lengths[i]++;
+		bucketOf[i] = enumNameHash(names[i].name, made.lengths[i], 0) & (Table::buckets - 1);
+		bucketSizes[bucketOf[i]]++;
+	}
+
+	// Equal names would never get separate slots, they always share a bucket
+	for (size_t i = 0; i < Count; i++) {
+		for (size_t j = 0; j < i; j++) {
+			if (bucketOf[i] != bucketOf[j] || made.lengths[i] != made.lengths[j])
+				continue;
+			size_t same = 0;
+			while (same < made.lengths[i] && names[i].name[same] == names[j].name[same])
+				same++;
+			if (same == made.lengths[i])
+				throw ArgumentError("Enum names must be unique");
+		}
+	}
+
+	// The largest buckets are the hardest to place, so they go first
+	bool placed[Table::buckets] = {};
+	for (size_t round = 0; round < Table::buckets; round++) {
+		size_t bucket = Table::buckets;
+		for (size_t i = 0; i < Table::buckets; i++) {
+			if (!placed[i] && (bucket == Table::buckets || bucketSizes[i] > bucketSizes[bucket]))
+				bucket = i;
+		}
+		placed[bucket] = true;
+		if (bucketSizes[bucket] == 0)
+			break;
+
+		for (uint32_t seed = 1; ; seed++) {
+			if (seed > (1u << 20))
+				throw ArgumentError("Cannot place the enum names into a lookup table");
+			size_t used[Count] = {};
+			size_t usedCount = 0;
+			bool fits = true;
+			for (size_t i = 0; i < Count && fits; i++) {
+				if (bucketOf[i] != bucket)
+					continue;
+				const size_t slot = enumNameHash(names[i].name, made.lengths[i], seed) & (Table::slots - 1);
+				if (made.entries[slot] != 0) {
+					fits = false;
+				} else {
+					made.entries[slot] = uint16_t(i + 1);
+					used[usedCount++] = slot;
+				}
+			}
+			if (fits) {
+				made.seeds[bucket] = seed;
+				break;
+			}
+			for (size_t i = 0; i < usedCount; i++)
+				made.entries[used[i]] = 0;
+		}
+	}
+	return made;
+}
+
+template <typename T>
+struct EnumTable {
+	using Names = decltype(EnumNames<T>::names());
+	using Table = PerfectHashTable<std::tuple_size<Names>::value>;
+	constexpr static Names names = EnumNames<T>::names();
+	constexpr static Table table = makePerfectHashTable(EnumNames<T>::names());
+
+	static const T* find(const char* name, size_t length) {
+		const uint32_t bucket = enumNameHash(name, length, 0) & (Table::buckets - 1);
+		const uint16_t entry = table.entries[enumNameHash(name, length, table.seeds[bucket]) & (Table::slots - 1)];
+		if (entry == 0 || table.lengths[entry - 1] != length || std::memcmp(names[entry - 1].name, name, length) != 0)
+			return nullptr;
+		return &names[entry - 1].value;
+	}
+	static std::string choices() {
+		return enumChoices(table.names, names.size());
+	}
+	static T get(const char* name, size_t length) {
+		const T* found = find(name, length);
+		if (!found)
+			throw invalidEnumValue(name, length, table.names, names.size());
+		return *found;
+	}
+};
+
+#if __cplusplus < 201703L
+template <typename T>
+constexpr typename EnumTable<T>::Names EnumTable<T>::names;
+template <typename T>
+constexpr typename EnumTable<T>::Table EnumTable<T>::table;
+#endif
+
+template <typename T>
+struct ArgConverter<T, typename std::enable_if<HasEnumNames<T>::value>::type> {
+	static T makeDefault() {
+		return EnumTable<T>::names[0].value;
+	}
+	static T deserialise(const std::string& from) {
+		return EnumTable<T>::get(from.data(), from.size());
+	}
+	static std::string choices() {
+		return EnumTable<T>::choices();
+	}
+	constexpr static bool canDo = true;
+};
+
+// Combination of flags from an enum whose values are bits, parsed from a comma separated list
+template <typename T>
+class EnumFlags {
+	using Underlying = typename std::underlying_type<T>::type;
+	Underlying _bits = 0;
+public:
+	EnumFlags() = default;
+	EnumFlags(T flag) : _bits(Underlying(flag)) {}
+	EnumFlags& operator|=(T flag) {
+		_bits |= Underlying(flag);
+		return *this;
+	}
+	bool has(T flag) const {
+		return (_bits & Underlying(flag)) == Underlying(flag);
+	}
+	Underlying bits() const {
+		return _bits;
+	}
+	operator T() const {
+		return T(_bits);
+	}
+};
+
+template <typename T>
+struct ArgConverter<EnumFlags<T>, typename std::enable_if<HasEnumNames<T>::value>::type> {
+	static EnumFlags<T> makeDefault() {
 		return {};
 	}
-	static std::filesystem::path deserialise(const std::string& from) {
-		return std::filesystem::path(from);
+	static EnumFlags<T> deserialise(const std::vector<std::string>& from) {
+		EnumFlags<T> made;
+		for (const std::string& part : from) {
+			if (part.empty())
+				continue; // No flags set
+			size_t lastPosition = 0;
+			for (size_t i = 0; i <= part.size(); i++) {
+				if (i == part.size() || part[i] == ',') {
+					made |= EnumTable<T>::get(part.data() + lastPosition, i - lastPosition);
+					lastPosition = i + 1;
+				}
+			}
+		}
+		return made;
+	}
+	static std::string choices() {
+		return "comma separated, " + EnumTable<T>::choices();
 	}
 	constexpr static bool canDo = true;
 };
 #endif
 
+// Binary data written in hexadecimal or base64, Bytes can be std::vector<uint8_t> or std::array<uint8_t, N>
+template <typename Bytes>
+struct Hex : Bytes {
+	Hex() = default;
+	Hex(const Bytes& bytes) : Bytes(bytes) {}
+};
+
+template <typename Bytes>
+struct Base64 : Bytes {
+	Base64() = default;
+	Base64(const Bytes& bytes) : Bytes(bytes) {}
+};
+
+QUICK_ARG_PARSER_FUNCTION bool decodeHex(const char* from, size_t length, uint8_t* to);
+QUICK_ARG_PARSER_FUNCTION size_t base64DecodedSize(const char* from, size_t length); // Returns -1 if the length is invalid
+QUICK_ARG_PARSER_FUNCTION bool decodeBase64(const char* from, size_t length, uint8_t* to);
+
+template <typename Bytes>
+struct ByteBuffer {};
+
+template <>
+struct ByteBuffer<std::vector<uint8_t>> {
+	static void resize(std::vector<uint8_t>& buffer, size_t size) {
+		buffer.resize(size);
+	}
+};
+
+template <size_t Size>
+struct ByteBuffer<std::array<uint8_t, Size>> {
+	static void resize(std::array<uint8_t, Size>&, size_t size) {
+		if (size != Size)
+			throw ArgumentError("Expected " + std::to_string(Size) + " bytes of data, got " + std::to_string(size));
+	}
+};
+
+template <typename Bytes>
+struct ArgConverter<Hex<Bytes>, void> {
+	static Hex<Bytes> makeDefault() {
+		return {};
+	}
+	static Hex<Bytes> deserialise(const std::string& from) {
+		if (from.size() % 2 != 0)
+			throw ArgumentError("Hexadecimal value " + from + " has an odd number of digits");
+		Hex<Bytes> made;
+		ByteBuffer<Bytes>::resize(made, from.size() / 2);
+		if (!decodeHex(from.data(), from.size(), made.data()))
+			throw ArgumentError("Invalid hexadecimal value " + from);
+		return made;
+	}
+	constexpr static bool canDo = true;
+};
+
+template <typename Bytes>
+struct ArgConverter<Base64<Bytes>, void> {
+	static Base64<Bytes> makeDefault() {
+		return {};
+	}
+	static Base64<Bytes> deserialise(const std::string& from) {
+		const size_t size = base64DecodedSize(from.data(), from.size());
+		if (size == size_t(-1))
+			throw ArgumentError("Base64 value " + from + " has invalid length");
+		Base64<Bytes> made;
+		ByteBuffer<Bytes>::resize(made, size);
+		if (!decodeBase64(from.data(), from.size(), made.data()))
+			throw ArgumentError("Invalid base64 value " + from);
+		return made;
+	}
+	constexpr static bool canDo = true;
+};
 
 template <typename T, typename SFINAE = void>
-struct Demultiplexer {
-	static T deserialise(const std::vector<std::string>& multiplexed) {
-		return ArgConverter<T>::deserialise(multiplexed);
+struct ChoicesProvider {
+	static std::string get() {
+		return "";
 	}
 };
 
 template <typename T>
-struct Demultiplexer<T, typename std::enable_if<!std::is_void<decltype(ArgConverter<T>::deserialise(std::declval<std::string>()))>::value>::type> {
-	static T deserialise(const std::vector<std::string>& multiplexed) {
-		if (multiplexed.size() > 1)
-			throw ArgumentError("Argument was not expected to appear more than once (" + multiplexed[1] + " is excessive)");
-		return ArgConverter<T>::deserialise(multiplexed[0]);
+struct ChoicesProvider<T, typename std::enable_if<!std::is_void<decltype(ArgConverter<T>::choices())>::value>::type> {
+	static std::string get() {
+		return ArgConverter<T>::choices();
 	}
 };
 
+
 template <typename T, typename SFINAE = void>
-struct HelpProvider{
-	template <typename F>
-	static std::string get(const F& ifAbsent, const std::string& programName) {
-		return ifAbsent(programName);
+struct Demultiplexer {
+	static T deserialise(const std::vector<std::string>& multiplexed) {
+		return ArgConverter<T>::deserialise(multiplexed);
 	}
+	constexpr static bool isList = true;
 };
 
 template <typename T>
-struct HelpProvider<T, typename std::enable_if<!std::is_void<decltype(T::help(std::declval<std::string>()))>::value>::type> {
-	template <typename F>
-	static std::string get(const F&, const std::string& programName) {
-		return T::help(programName);
+struct Demultiplexer<T, typename std::enable_if<!std::is_void<decltype(ArgConverter<T>::deserialise(std::declval<std::string>()))>::value>::type> {
+	static T deserialise(const std::vector<std::string>& multiplexed) {
+		if (multiplexed.size() > 1)
+			throw ArgumentError("Argument was not expected to appear more than once (" + multiplexed[1] + " is excessive)");
+		return ArgConverter<T>::deserialise(multiplexed[0]);
 	}
+	constexpr static bool isList = false;
 };
 
 template <typename T, typename SFINAE = void>
@@ -283,28 +650,66 @@ struct HasHelpOptionsProvider<T, typename std::enable_if<
 		!std::is_void<decltype(T::options())>::value>::type>
 		: std::true_type {};
 
+template <typename T, typename SFINAE = void>
+struct LimitsProvider {
+	static ParsingLimits get() {
+		return {};
+	}
+};
+
+template <typename T>
+struct LimitsProvider<T, typename std::enable_if<std::is_same<ParsingLimits, decltype(T::limits())>::value>::type> {
+	static ParsingLimits get() {
+		return T::limits();
+	}
+};
+
+template <typename T, typename SFINAE = void>
+struct IsCacheable : std::false_type {};
+
+template <typename T>
+struct IsCacheable<T, typename std::enable_if<T::cacheable>::type> : std::true_type {};
+
+QUICK_ARG_PARSER_FUNCTION void printText(const std::string& text);
+
+template <typename T, typename SFINAE = void>
+struct OutputSink {
+	static void print(const std::string& text) {
+		printText(text);
+	}
+};
+
+template <typename T>
+struct OutputSink<T, typename std::enable_if<std::is_void<decltype(T::output(std::declval<const std::string&>()))>::value>::type> {
+	static void print(const std::string& text) {
+		T::output(text);
+	}
+};
 
 template <typename T, typename SFINAE = void>
 struct VersionPrinter {
 	static bool print() {
 		return false;
 	}
+	constexpr static bool known = false;
 };
 
 template <typename T>
 struct VersionPrinter<T, typename std::enable_if<!std::is_void<decltype(std::string(T::version))>::value>::type> {
 	static bool print() {
-		std::cout << T::version << std::endl;
+		OutputSink<T>::print(std::string(T::version) + '\n');
 		return true;
 	}
+	constexpr static bool known = true;
 };
 
 template <typename T>
 struct VersionPrinter<T, typename std::enable_if<!std::is_void<decltype(std::string(T::version()))>::value>::type> {
 	static bool print() {
-		std::cout << T::version() << std::endl;
+		OutputSink<T>::print(std::string(T::version()) + '\n');
 		return true;
 	}
+	constexpr static bool known = true;
 };
 
 template <typename T, typename SFINAE = void>
@@ -362,223 +767,1610 @@ struct ValidatorUser<Validator, typename std::enable_if<!std::is_same<Validator,
 	}
 };
 
-} // namespace
+// Constructs the class either through an inherited constructor or by aggregate initialisation (possible since C++17)
+template <typename Child, typename std::enable_if<std::is_constructible<Child, int, char**>::value>::type* = nullptr>
+Child* constructArguments(int argc, char** argv) {
+	return new Child(argc, argv);
+}
 
-template <typename Child>
-class MainArguments {
-	std::string _programName;
-	std::vector<std::string> _argv;
-	
-	enum InitialisationStep {
-		UNINITIALISED,
-		INITIALISING,
-		INITIALISED
-	};
-	struct Singleton {
-		std::stringstream helpPreface;
-		std::stringstream help;
-		std::vector<std::pair<std::string, char>> nullarySwitches;
-		std::vector<std::pair<std::string, char>> unarySwitches;
-		std::vector<std::string> confusingSwitches; // nonstandard switches starting with a single dash
-		int argumentCountMin = 0;
-		int argumentCountMax = 0;
-		InitialisationStep initialisationState = UNINITIALISED;
+template <typename Child, typename std::enable_if<!std::is_constructible<Child, int, char**>::value>::type* = nullptr>
+Child* constructArguments(int argc, char** argv) {
+	return new Child{{argc, argv}};
+}
+
+template <typename Child, typename std::enable_if<std::is_constructible<Child, int, char**>::value>::type* = nullptr>
+Child makeArguments(int argc, char** argv) {
+	return Child(argc, argv);
+}
+
+template <typename Child, typename std::enable_if<!std::is_constructible<Child, int, char**>::value>::type* = nullptr>
+Child makeArguments(int argc, char** argv) {
+	return Child{{argc, argv}};
+}
+
+// A part of an argument, pointing into argv, valid as long as argv is
+struct ArgView {
+	const char* data = nullptr;
+	size_t size = 0;
+	ArgView() = default;
+	ArgView(const char* data, size_t size) : data(data), size(size) {}
+	explicit ArgView(const char* data) : data(data), size(std::strlen(data)) {}
+	bool operator==(const std::string& other) const {
+		return size == other.size() && std::memcmp(data, other.data(), size) == 0;
+	}
+	bool operator!=(const std::string& other) const {
+		return !(*this == other);
+	}
+	std::string str() const {
+		return std::string(data, size);
+	}
+#if __cplusplus > 201402L
+	operator std::string_view() const {
+		return std::string_view(data, size);
+	}
+#endif
+};
+
+struct Token {
+	enum Kind {
+		LONG_OPTION, // Name with the dashes, like --port or a nonstandard option like -line
+		SHORT_OPTION, // Name is one letter of a group like -xvf
+		POSITIONAL, // Only the value is set
+		TERMINATOR // The -- argument, everything after it is positional
 	};
-	static Singleton& singleton() {
-		static Singleton instance;
-		return instance;
+	Kind kind = POSITIONAL;
+	ArgView name;
+	ArgView value;
+	bool hasValue = false; // Set if written after =, as the rest of a group of short options or as the next argument
+	int index = 0; // Position in argv where the token starts
+	int option = -1; // Can be set by the classifier to identify the option
+};
+
+// Classifier used if no option takes a value (values can still be given after =)
+struct NoValueOptions {
+	bool takesValue(Token&) const {
+		return false;
 	}
-	
-	using DummyValidator = QuickArgParserInternals::DummyValidator;
-public:
-	template <typename T> using Optional = QuickArgParserInternals::Optional<T>;
-	MainArguments() = default;
-	MainArguments(int argc, char** argv) : _programName(argv[0]), _argv(argv + 1, argv + argc) {
-		using namespace QuickArgParserInternals;
-		if (singleton().initialisationState == UNINITIALISED) {
-			// When first created, create temporarily another instance to explore what are the members
-			singleton().initialisationState = INITIALISING;
+	size_t nonstandardLength(const char*) const {
+		return 0;
+	}
+};
 
-			Child investigator;
-			// This will fill the static variables
-			singleton().helpPreface << QuickArgParserInternals::HelpProvider<Child>::get([] (const std::string& programName) {
-				return programName + " takes between " + std::to_string(singleton().argumentCountMin) + " and " +
-						std::to_string(singleton().argumentCountMax) + " arguments, plus these options:";
-			}, _programName);
+// Splits argv into options and their values without allocating, the classifier tells which options take a value
+// and which nonstandard options (like -line or /tool) exist, see NoValueOptions for its interface
+template <typename Classifier = NoValueOptions>
+class Tokenizer {
+	int _argc;
+	const char* const* _argv;
+	int _position = 1; // The program name is skipped
+	const char* _group = nullptr; // Next letter of a group of short options
+	bool _switchesEnabled = true;
+	Classifier _classifier;
 
-			singleton().initialisationState = INITIALISED;
+	void takeValue(Token& token, const char* rest) {
+		// Rest is what remains of the current argument
+		if (*rest != '\0') {
+			token.value = ArgView(rest);
+			token.hasValue = true;
+		} else if (_position + 1 < _argc) {
+			_position++;
+			token.value = ArgView(_argv[_position]);
+			token.hasValue = true;
 		}
-		if (singleton().initialisationState == INITIALISED) {
-			bool switchesEnabled = true;
-			auto isListedAsChar = [] (const char arg, const std::vector<std::pair<std::string, char>>& switches) {
-				for (const auto& it : switches) {
-					if (it.second == arg)
-						return true;
-				}
-				return false;
-			};
-			auto isListedAsString = [] (const std::string& arg, const std::vector<std::pair<std::string, char>>& switches, bool unary, bool& skipsNext) {
-				for (const auto& it : switches) {
-					for (int i = 0; i < int(it.first.size()); i++) {
-						if (arg[i] != it.first[i])
-							goto noMatch;
-					}
-					if (arg.size() == it.first.size()) {
-						skipsNext = true;
-						return true;
-					}
-					if (unary && arg[it.first.size()] == '=') {
-						skipsNext = false;
-						return true;
-					}
-					noMatch:;
-				}
-				return false;
-			};
-			auto printHelp = [this] () {
-				std::cout << singleton().helpPreface.str() << std::endl;
-				std::cout << singleton().help.str() << std::endl;
-				
-				QuickArgParserInternals::OnHelpCallback<Child>::on(static_cast<Child*>(this), [] { std::exit(0); });
-			};
-			auto printVersion = [this] () {
-				if (!QuickArgParserInternals::VersionPrinter<Child>::print())
-					return false; // Returns false if the version is not known, leading to no action if found
-					
-				QuickArgParserInternals::OnVersionCallback<Child>::on(static_cast<Child*>(this), [] { std::exit(0); });
-				return true;
-			};
+	}
 
-			// Collect program arguments (as opposed to switches) and validate everything
-			for (int i = 0; i < int(_argv.size()); i++) {
-				if (switchesEnabled) {
-					if (_argv[i] == "--help") {
-						printHelp();
-						goto nextArg;
-					}
-					if (_argv[i] == "--version") {
-						if (printVersion())
-							goto nextArg;
-					}
-					if (_argv[i] == "--") {
-						switchesEnabled = false;
-						goto nextArg;
-					}
-					bool skipsNext = false;
-					if (isListedAsString(_argv[i], singleton().unarySwitches, true, skipsNext)) {
-						if (skipsNext)
-							i++; // The next argument is part of the switch
-						goto nextArg;
-					} else if (isListedAsString(_argv[i], singleton().nullarySwitches, false, skipsNext)) {
-						goto nextArg;
-					}
-					
-					
-					if (_argv[i][0] == '-') {
-						if (_argv[i][1] == '-')
-							throw ArgumentError("Unknown switch " + _argv[i]);
-						
-						// Starts with -
-						if (_argv[i].size() == 2) {
-							// Is an argument of type -x
-							if (_argv[i][1] == '?') {
-								printHelp();
-									goto nextArg;
-							}
-							if (_argv[i][1] == 'V') {
-								if (printVersion())
-									goto nextArg;
-							}
-						}
-						
-						// Some validations that all massed single letter switches
-						for (int j = 1; j < int(_argv[i].size()); j++) {
-							if (isListedAsChar(_argv[i][j], singleton().unarySwitches)) {
-								if (j == int(_argv[i].size()) - 1) {
-									i++; // The next argument is part of the switch
-								}	
-								goto nextArg;
-							}
-							if (!isListedAsChar(_argv[i][j], singleton().nullarySwitches)) {
-								throw ArgumentError(std::string("Unknown switch ") + _argv[i][j]);
-							}
-						}
-						goto nextArg;
-					}
+public:
+	Tokenizer(int argc, const char* const* argv, Classifier classifier = Classifier())
+			: _argc(argc), _argv(argv), _classifier(classifier) {}
+
+	// Returns false at the end
+	bool next(Token& token) {
+		token = Token();
+		if (_group) {
+			token.kind = Token::SHORT_OPTION;
+			token.index = _position;
+			token.name = ArgView(_group, 1);
+			_group++;
+			if (_classifier.takesValue(token)) {
+				if (*_group == '=') {
+					token.value = ArgView(_group + 1); // Can be empty, like -n=
+					token.hasValue = true;
+				} else {
+					takeValue(token, _group);
 				}
-				
-				// Is not a switch, continue was not used
-				arguments.push_back(_argv[i]);
-				
-				nextArg:;
+				_group = nullptr;
+			} else if (*_group == '\0') {
+				_group = nullptr;
 			}
-
-			if (int(arguments.size()) < singleton().argumentCountMin)
-				throw ArgumentError("Expected at least " + std::to_string(singleton().argumentCountMin)
-						+ " arguments, got " + std::to_string(arguments.size()));
-			if (int(arguments.size()) > singleton().argumentCountMax)
-				throw ArgumentError("Expected at most " + std::to_string(singleton().argumentCountMax)
-						+ " arguments, got " + std::to_string(arguments.size()));
+			if (!_group)
+				_position++;
+			return true;
 		}
-	}
-	std::vector<std::string> arguments;
 
-private:
-	
-	std::vector<std::string> findOption(const std::string& argument, char shortcut) const {
-		// This returns hogwash if the option is bool, but in that case, we only care that the vector is not empty
-		std::vector<std::string> collected;
-		auto matches = [&] (const std::string& matched, int argument) {
-			for (int i = 0; i < int(matched.size()); i++) {
-				if (matched[i] != _argv[argument][i])
-					return false;
-			}
-			return matched.size() == _argv[argument].size() || _argv[argument][matched.size()] == '=';
-		};
-	
-		for (int i = 0; i < int(_argv.size()); i++) {
-			// Look for shortcut, end of string means no shortcut
-			if (shortcut != '\0') {
-				// Skip this if it is a strange switch starting with a single dash
-				for (const auto& it : singleton().confusingSwitches)
-					if (matches(it, i))
-						goto skipThisOne;
-				
-				if (_argv[i][0] == '-' && _argv[i][1] != '-') {
-					for (int j = 1; _argv[i][j] != '\0'; j++) {
-						if (_argv[i][j] == shortcut) {
-							if (_argv[i][j + 1] == '\0') // Last letter, argument follows
-								collected.push_back(_argv[std::min<int>(i + 1, _argv.size() - 1)]);
-							else if (_argv[i][j + 1] == '=') // Argument value not sperated
-								collected.push_back(_argv[i].substr(j + 2));
-							else
-								collected.push_back(_argv[i].substr(j + 1));
-						}
-						
-						for (auto& it : singleton().unarySwitches)
-							if (it.second == _argv[i][j])
-								goto skipThisOne; // It is a switch followed by arguments
-					}
+		if (_position >= _argc)
+			return false;
+		const char* arg = _argv[_position];
+		token.index = _position;
+		if (_switchesEnabled) {
+			size_t nameLength = _classifier.nonstandardLength(arg);
+			if (nameLength == 0 && arg[0] == '-' && arg[1] == '-') {
+				if (arg[2] == '\0') {
+					token.kind = Token::TERMINATOR;
+					token.name = ArgView(arg, 2);
+					_switchesEnabled = false;
+					_position++;
+					return true;
 				}
-				if (_argv[i] == "--") {
-					break;
+				nameLength = std::strcspn(arg, "=");
+			}
+			if (nameLength > 0) {
+				token.kind = Token::LONG_OPTION;
+				token.name = ArgView(arg, nameLength);
+				const bool takesValue = _classifier.takesValue(token);
+				if (arg[nameLength] == '=') {
+					token.value = ArgView(arg + nameLength + 1);
+					token.hasValue = true;
+				} else if (takesValue) {
+					takeValue(token, arg + nameLength);
 				}
-				
-				skipThisOne:;
+				_position++;
+				return true;
 			}
-			
-			// Look for full argument name, empty means no full argument name
-			if (!argument.empty()) {
-				if (matches(argument, i)) {
-					if (_argv[i].size() > argument.size() && _argv[i][argument.size()] == '=')
-						collected.push_back(_argv[i].substr(argument.size() + 1));
-					else
-						collected.push_back(_argv[std::min<int>(i + 1, _argv.size() - 1)]);
+			if (arg[0] == '-' && arg[1] != '\0') {
+				_group = arg + 1;
+				return next(token);
+			}
+		}
+
+		token.kind = Token::POSITIONAL;
+		token.value = ArgView(arg);
+		token.hasValue = true;
+		_position++;
+		return true;
+	}
+
+	class iterator {
+		Tokenizer* _parent;
+		Token _token;
+	public:
+		iterator(Tokenizer* parent) : _parent(parent) {
+			if (_parent && !_parent->next(_token))
+				_parent = nullptr;
+		}
+		const Token& operator*() const {
+			return _token;
+		}
+		const Token* operator->() const {
+			return &_token;
+		}
+		iterator& operator++() {
+			if (!_parent->next(_token))
+				_parent = nullptr;
+			return *this;
+		}
+		bool operator==(const iterator& other) const {
+			return _parent == other._parent;
+		}
+		bool operator!=(const iterator& other) const {
+			return _parent != other._parent;
+		}
+	};
+	// Iterating consumes the tokens
+	iterator begin() {
+		return iterator(this);
+	}
+	iterator end() {
+		return iterator(nullptr);
+	}
+};
+
+// Remembers that a default value was validated, can be set from multiple threads
+class ValidatedFlag {
+#if defined(__GNUC__) || defined(__clang__)
+	bool _set = false;
+public:
+	bool get() const {
+		return __atomic_load_n(&_set, __ATOMIC_ACQUIRE);
+	}
+	void set() {
+		__atomic_store_n(&_set, true, __ATOMIC_RELEASE);
+	}
+#else
+	std::atomic<bool> _set{false};
+public:
+	bool get() const {
+		return _set.load(std::memory_order_acquire);
+	}
+	void set() {
+		_set.store(true, std::memory_order_release);
+	}
+#endif
+};
+
+// Validation postponed until all members are parsed
+struct DeferredCheck {
+	virtual bool operator()() const = 0; // Returning false or throwing means invalid
+	virtual ~DeferredCheck() = default;
+};
+
+template <typename Validator, typename T>
+struct DeferredValidator : DeferredCheck {
+	Validator validator;
+	T value;
+	ValidatedFlag* validDefault;
+	DeferredValidator(const Validator& validator, const T& value, ValidatedFlag* validDefault)
+			: validator(validator), value(value), validDefault(validDefault) {}
+	bool operator()() const override {
+		if (!ValidatorUser<Validator>::useValidator(validator, value))
+			return false;
+		if (validDefault)
+			validDefault->set();
+		return true;
+	}
+};
+
+// Marks validators set through concurrentValidator(), only these can be deferred
+template <typename Validator>
+struct Concurrent {
+	Validator validator;
+};
+
+struct DeferredValidation {
+	std::unique_ptr<DeferredCheck> check;
+	std::string name;
+};
+
+// Work split between threads by parallelFor(), it must not throw
+struct ParallelJob {
+	virtual void operator()(size_t index) const = 0;
+protected:
+	~ParallelJob() = default;
+};
+
+template <typename F>
+struct FunctionJob : ParallelJob {
+	const F& function;
+	FunctionJob(const F& function) : function(function) {}
+	void operator()(size_t index) const override {
+		function(index);
+	}
+};
+
+template <typename F>
+FunctionJob<F> makeJob(const F& function) {
+	return FunctionJob<F>(function);
+}
+
+struct Schema {
+	std::string help;
+	std::vector<std::pair<std::string, char>> nullarySwitches;
+	std::vector<std::pair<std::string, char>> unarySwitches;
+	std::vector<std::string> confusingSwitches; // nonstandard switches starting with a single dash
+	std::vector<std::string> nullaryEnvironment; // Environment variables read if the switch is not set, empty if none
+	std::vector<std::string> unaryEnvironment;
+	int argumentCountMin = 0;
+	int argumentCountMax = 0;
+	uint64_t fingerprint = 0;
+	ParsingLimits limits;
+	std::vector<ValidatedFlag> validDefaults; // Default values of switches followed by default values of arguments
+};
+
+// Refers to a snapshot created by MainArguments::snapshot(), the data is not copied
+struct Snapshot {
+	const char* data;
+	size_t size;
+	Snapshot(const char* data, size_t size) : data(data), size(size) {}
+	Snapshot(const std::string& data) : data(data.data()), size(data.size()) {}
+};
+
+// A switch in a FlagSet, the name is without the leading dashes
+struct Flag {
+	std::string name;
+	char shortcut;
+	std::string help;
+	Flag(const std::string& name, char shortcut, const std::string& help = "") : name(name), shortcut(shortcut), help(help) {}
+};
+
+// Boolean switches stored together, indexed in the order they were declared
+template <size_t Count>
+class FlagSet {
+	std::array<uint8_t, Count> _counts = {}; // Saturates at 255
+public:
+	void set(size_t index, size_t count) {
+		_counts[index] = uint8_t(count < 255 ? count : 255);
+	}
+	bool operator[](size_t index) const {
+		return _counts[index] > 0;
+	}
+	// How many times it was set, like verbosity set by -vvv
+	int count(size_t index) const {
+		return _counts[index];
+	}
+	// How many of the flags are set
+	size_t setCount() const {
+		size_t set = 0;
+		for (uint8_t it : _counts)
+			set += it > 0;
+		return set;
+	}
+	bool any() const {
+		return setCount() > 0;
+	}
+};
+
+struct SpecialOptionHandler {
+	virtual void help() = 0;
+	virtual bool version() = 0; // Returns false if the version is not known
+protected:
+	~SpecialOptionHandler() = default;
+};
+
+// Identifies the options of a schema for the tokenizer, option indexes are nullary switches followed by unary switches
+struct SchemaClassifier {
+	const Schema* schema;
+	QUICK_ARG_PARSER_FUNCTION bool takesValue(Token& token) const;
+	QUICK_ARG_PARSER_FUNCTION size_t nonstandardLength(const char* arg) const;
+};
+
+// The part of ParseCache that doesn't depend on the parsed class, it keeps the parsed instances untyped,
+// it's a template only so that programs that don't use it don't compile it
+template <typename Untyped = const void>
+class CacheIndex {
+	struct State;
+	std::unique_ptr<State> _state;
+public:
+	struct Key {
+		uint64_t hash;
+		std::vector<std::string> environment; // Values of the environment variables read by the class
+	};
+	CacheIndex(const Schema& schema, size_t capacity);
+	~CacheIndex();
+	Key makeKey(int argc, char** argv) const;
+	// Counts a hit or a miss, returns null if the command line is not there
+	std::shared_ptr<Untyped> find(const Key& key, int argc, char** argv);
+	// Returns the instance already there if another thread inserted the same command line meanwhile
+	std::shared_ptr<Untyped> insert(const Key& key, int argc, char** argv, std::shared_ptr<Untyped> parsed);
+	size_t hits() const;
+	size_t misses() const;
+	size_t size() const;
+	void clear();
+};
+
+QUICK_ARG_PARSER_FUNCTION void checkLimits(const ParsingLimits& limits, int argc, char** argv);
+QUICK_ARG_PARSER_FUNCTION void checkListLimit(const ParsingLimits& limits, const std::vector<std::string>& values, const std::string& name);
+QUICK_ARG_PARSER_FUNCTION std::string defaultHelpPreface(const std::string& programName, int argumentCountMin, int argumentCountMax);
+QUICK_ARG_PARSER_FUNCTION void addHelpEntry(std::string& help, const std::string& name, char shortcut, const std::string& entry);
+QUICK_ARG_PARSER_FUNCTION void resolveArguments(const Schema& schema, int argc, const char* const* argv, SpecialOptionHandler& handler,
+		std::vector<std::string>& arguments, std::vector<std::vector<std::string>>& resolved);
+QUICK_ARG_PARSER_FUNCTION void resolveEnvironment(const Schema& schema, std::vector<std::vector<std::string>>& resolved);
+QUICK_ARG_PARSER_FUNCTION std::vector<std::string> splitCommandLine(const std::string& commandLine);
+QUICK_ARG_PARSER_FUNCTION bool readFile(const std::string& path, std::string& contents);
+QUICK_ARG_PARSER_FUNCTION void parallelFor(size_t count, size_t threadCount, const ParallelJob& job);
+QUICK_ARG_PARSER_FUNCTION size_t hardwareThreads();
+constexpr size_t defaultValidationThreads = 16; // Used by parse() for validators set through concurrentValidator()
+QUICK_ARG_PARSER_FUNCTION void runValidations(const std::vector<DeferredValidation>& validations, size_t threadCount);
+QUICK_ARG_PARSER_FUNCTION uint64_t hashBytes(const char* data, size_t size, uint64_t hash = 14695981039346656037ull);
+QUICK_ARG_PARSER_FUNCTION uint64_t schemaFingerprint(const Schema& schema);
+QUICK_ARG_PARSER_FUNCTION std::string writeSnapshot(const Schema& schema, const std::string& programName,
+		const std::vector<std::string>& arguments, const std::vector<std::vector<std::string>>& resolved);
+QUICK_ARG_PARSER_FUNCTION void readSnapshot(const Schema& schema, Snapshot snapshot, std::string& programName,
+		std::vector<std::string>& arguments, std::vector<std::vector<std::string>>& resolved);
+QUICK_ARG_PARSER_FUNCTION std::vector<std::string> canonicalCommandLine(const Schema& schema, const std::string& programName,
+		const std::vector<std::string>& arguments, const std::vector<std::vector<std::string>>& resolved);
+QUICK_ARG_PARSER_FUNCTION void finishSchema(Schema& schema, const ParsingLimits& limits);
+QUICK_ARG_PARSER_FUNCTION void registerSwitch(Schema& schema, bool unary, const std::string& name, char shortcut, const std::string& help,
+		const std::string& choices, const std::string& environment, bool listedInHelp);
+QUICK_ARG_PARSER_FUNCTION void registerArgument(Schema& schema, int index, bool required);
+QUICK_ARG_PARSER_FUNCTION int switchIndex(const Schema& schema, const std::string& name, char shortcut); // Negative if not found
+QUICK_ARG_PARSER_FUNCTION const std::vector<std::string>& resolvedValues(const Schema& schema,
+		const std::vector<std::vector<std::string>>& resolved, const std::string& name, char shortcut);
+
+template <typename T, typename SFINAE = void>
+struct HelpProvider{
+	static std::string get(const Schema& schema, const std::string& programName) {
+		return defaultHelpPreface(programName, schema.argumentCountMin, schema.argumentCountMax);
+	}
+};
+
+template <typename T>
+struct HelpProvider<T, typename std::enable_if<!std::is_void<decltype(T::help(std::declval<std::string>()))>::value>::type> {
+	static std::string get(const Schema&, const std::string& programName) {
+		return T::help(programName);
+	}
+};
+
+#ifdef QUICK_ARG_PARSER_SEPARATE_COMPILATION
+// Instantiated in quick_arg_parser.cpp
+extern template struct ArgConverter<int>;
+extern template struct ArgConverter<long int>;
+extern template struct ArgConverter<unsigned int>;
+extern template struct ArgConverter<float>;
+extern template struct ArgConverter<double>;
+extern template struct ArgConverter<std::vector<int>>;
+extern template struct ArgConverter<std::vector<std::string>>;
+extern template struct Demultiplexer<int>;
+extern template struct Demultiplexer<long int>;
+extern template struct Demultiplexer<unsigned int>;
+extern template struct Demultiplexer<float>;
+extern template struct Demultiplexer<double>;
+extern template struct Demultiplexer<std::string>;
+extern template struct Demultiplexer<std::vector<int>>;
+extern template struct Demultiplexer<std::vector<std::string>>;
+extern template class CacheIndex<>;
+#endif
+
+#if !defined(QUICK_ARG_PARSER_SEPARATE_COMPILATION) || defined(QUICK_ARG_PARSER_IMPLEMENTATION)
+
+QUICK_ARG_PARSER_FUNCTION void printText(const std::string& text) {
+#ifdef QUICK_ARG_PARSER_NO_IOSTREAM
+	const char* data = text.data();
+	size_t left = text.size();
+	while (left > 0) {
+#ifdef _WIN32
+		const int written = _write(1, data, unsigned(left));
+#else
+		const ssize_t written = write(1, data, left);
+#endif
+		if (written < 0 && errno == EINTR)
+			continue;
+		if (written <= 0)
+			return; // Nowhere to print it
+		data += written;
+		left -= written;
+	}
+#else
+	std::cout << text << std::flush;
+#endif
+}
+
+QUICK_ARG_PARSER_FUNCTION void checkLimits(const ParsingLimits& limits, int argc, char** argv) {
+	if (limits.maxTokens != 0 && size_t(argc - 1) > limits.maxTokens)
+		throw LimitError("Too many arguments, at most " + std::to_string(limits.maxTokens) + " are allowed");
+	size_t total = 0;
+	for (int i = 1; i < argc; i++) {
+		// Never read further than the limits allow
+		size_t bound = size_t(-1);
+		if (limits.maxTokenLength != 0)
+			bound = limits.maxTokenLength;
+		if (limits.maxTotalBytes != 0)
+			bound = std::min(bound, limits.maxTotalBytes - total);
+		size_t length = 0;
+		while (length <= bound && argv[i][length] != '\0')
+			length++;
+		if (limits.maxTokenLength != 0 && length > limits.maxTokenLength)
+			throw LimitError("Argument " + std::to_string(i) + " is too long, at most " + std::to_string(limits.maxTokenLength)
+					+ " bytes are allowed");
+		total += length;
+		if (limits.maxTotalBytes != 0 && total > limits.maxTotalBytes)
+			throw LimitError("Arguments are too long, at most " + std::to_string(limits.maxTotalBytes) + " bytes are allowed");
+	}
+}
+
+QUICK_ARG_PARSER_FUNCTION void checkListLimit(const ParsingLimits& limits, const std::vector<std::string>& values, const std::string& name) {
+	if (limits.maxListElements == 0)
+		return;
+	size_t elements = 0;
+	for (const std::string& value : values)
+		elements += 1 + std::count(value.begin(), value.end(), ',');
+	if (elements > limits.maxListElements)
+		throw LimitError("Argument " + name + " has too many elements, at most " + std::to_string(limits.maxListElements)
+				+ " are allowed");
+}
+
+QUICK_ARG_PARSER_FUNCTION std::string enumChoices(const char* const* names, size_t count) {
+	std::string listed = "one of:";
+	for (size_t i = 0; i < count; i++) {
+		listed += i == 0 ? " " : ", ";
+		listed += names[i];
+	}
+	return listed;
+}
+
+QUICK_ARG_PARSER_FUNCTION ArgumentError invalidEnumValue(const char* value, size_t length, const char* const* names, size_t count) {
+	return ArgumentError("Invalid value " + std::string(value, length) + ", expected " + enumChoices(names, count));
+}
+
+QUICK_ARG_PARSER_FUNCTION bool decodeHex(const char* from, size_t length, uint8_t* to) {
+	size_t position = 0;
+#ifdef QUICK_ARG_PARSER_SSE2
+	// Converts 16 digits at once, digits and letters are told apart by signed comparisons that also reject bytes above 127
+	for (; position + 16 <= length; position += 16) {
+		const __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from + position));
+		const __m128i lowercase = _mm_or_si128(input, _mm_set1_epi8(0x20));
+		const __m128i isDigit = _mm_and_si128(_mm_cmpgt_epi8(input, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(input, _mm_set1_epi8('9' + 1)));
+		const __m128i isLetter = _mm_and_si128(_mm_cmpgt_epi8(lowercase, _mm_set1_epi8('a' - 1)),
+				_mm_cmplt_epi8(lowercase, _mm_set1_epi8('f' + 1)));
+		if (_mm_movemask_epi8(_mm_or_si128(isDigit, isLetter)) != 0xffff)
+			return false;
+		const __m128i nibbles = _mm_or_si128(_mm_and_si128(isDigit, _mm_sub_epi8(input, _mm_set1_epi8('0'))),
+				_mm_and_si128(isLetter, _mm_sub_epi8(lowercase, _mm_set1_epi8('a' - 10))));
+		// Each 16 bit lane holds the high nibble in its first byte and the low nibble in its second byte
+		const __m128i merged = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(nibbles, _mm_set1_epi16(0x00ff)), 4), _mm_srli_epi16(nibbles, 8));
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(to + position / 2), _mm_packus_epi16(merged, merged));
+	}
+#endif
+	auto nibble = [] (char digit) {
+		if (digit >= '0' && digit <= '9')
+			return digit - '0';
+		digit |= 0x20;
+		if (digit >= 'a' && digit <= 'f')
+			return digit - 'a' + 10;
+		return -1;
+	};
+	for (; position + 1 < length; position += 2) {
+		const int high = nibble(from[position]);
+		const int low = nibble(from[position + 1]);
+		if (high < 0 || low < 0)
+			return false;
+		to[position / 2] = uint8_t((high << 4) | low);
+	}
+	return position == length;
+}
+
+QUICK_ARG_PARSER_FUNCTION size_t base64DecodedSize(const char* from, size_t length) {
+	if (length % 4 != 0)
+		return size_t(-1);
+	size_t padding = 0;
+	while (padding < 2 && padding < length && from[length - padding - 1] == '=')
+		padding++;
+	return length / 4 * 3 - padding;
+}
+
+QUICK_ARG_PARSER_FUNCTION bool decodeBase64(const char* from, size_t length, uint8_t* to) {
+	if (length % 4 != 0)
+		return false;
+	size_t position = 0;
+	size_t written = 0;
+#ifdef QUICK_ARG_PARSER_SSE2
+	// Translates 16 characters at once, the last group of 4 is left for the scalar code because it may contain padding
+	for (; position + 20 <= length; position += 16) {
+		const __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from + position));
+		auto inRange = [&] (char first, char last) {
+			return _mm_and_si128(_mm_cmpgt_epi8(input, _mm_set1_epi8(first - 1)), _mm_cmplt_epi8(input, _mm_set1_epi8(last + 1)));
+		};
+		const __m128i isUpper = inRange('A', 'Z');
+		const __m128i isLower = inRange('a', 'z');
+		const __m128i isDigit = inRange('0', '9');
+		const __m128i isPlus = _mm_cmpeq_epi8(input, _mm_set1_epi8('+'));
+		const __m128i isSlash = _mm_cmpeq_epi8(input, _mm_set1_epi8('/'));
+		if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_or_si128(isUpper, isLower), _mm_or_si128(isDigit, isPlus)), isSlash)) != 0xffff)
+			return false;
+		const __m128i sextets = _mm_or_si128(_mm_or_si128(
+				_mm_or_si128(_mm_and_si128(isUpper, _mm_sub_epi8(input, _mm_set1_epi8('A'))),
+						_mm_and_si128(isLower, _mm_sub_epi8(input, _mm_set1_epi8('a' - 26)))),
+				_mm_or_si128(_mm_and_si128(isDigit, _mm_add_epi8(input, _mm_set1_epi8(52 - '0'))),
+						_mm_and_si128(isPlus, _mm_set1_epi8(62)))),
+				_mm_and_si128(isSlash, _mm_set1_epi8(63)));
+		// Merge pairs of sextets into 12 bit values, then pairs of those into the 24 bits of each group of 4 characters
+		const __m128i pairs = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(sextets, _mm_set1_epi16(0x00ff)), 6), _mm_srli_epi16(sextets, 8));
+		const __m128i groups = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(pairs, _mm_set1_epi32(0xffff)), 12), _mm_srli_epi32(pairs, 16));
+		alignas(16) uint32_t decoded[4];
+		_mm_store_si128(reinterpret_cast<__m128i*>(decoded), groups);
+		for (uint32_t group : decoded) {
+			to[written++] = uint8_t(group >> 16);
+			to[written++] = uint8_t(group >> 8);
+			to[written++] = uint8_t(group);
+		}
+	}
+#endif
+	auto sextet = [] (char letter) {
+		if (letter >= 'A' && letter <= 'Z')
+			return letter - 'A';
+		if (letter >= 'a' && letter <= 'z')
+			return letter - 'a' + 26;
+		if (letter >= '0' && letter <= '9')
+			return letter - '0' + 52;
+		if (letter == '+')
+			return 62;
+		if (letter == '/')
+			return 63;
+		return -1;
+	};
+	for (; position < length; position += 4) {
+		const bool last = (position + 4 == length);
+		const int padding = (last && from[position + 3] == '=') ? (from[position + 2] == '=' ? 2 : 1) : 0;
+		int values[4] = {};
+		for (int i = 0; i < 4 - padding; i++) {
+			values[i] = sextet(from[position + i]);
+			if (values[i] < 0)
+				return false;
+		}
+		const uint32_t group = (values[0] << 18) | (values[1] << 12) | (values[2] << 6) | values[3];
+		if (padding > 0 && (group & ((1u << (padding * 8)) - 1)) != 0)
+			return false; // Bits that don't fit into the output must be zero
+		to[written++] = uint8_t(group >> 16);
+		if (padding < 2)
+			to[written++] = uint8_t(group >> 8);
+		if (padding < 1)
+			to[written++] = uint8_t(group);
+	}
+	return true;
+}
+
+QUICK_ARG_PARSER_FUNCTION std::string defaultHelpPreface(const std::string& programName, int argumentCountMin, int argumentCountMax) {
+	return programName + " takes between " + std::to_string(argumentCountMin) + " and " +
+			std::to_string(argumentCountMax) + " arguments, plus these options:";
+}
+
+QUICK_ARG_PARSER_FUNCTION void addHelpEntry(std::string& help, const std::string& name, char shortcut, const std::string& entry) {
+	if (shortcut != '\0') {
+		help += '-';
+		help += shortcut;
+	}
+	help += '\t';
+	help += name;
+	help += "\t ";
+	help += entry;
+	help += '\n';
+}
+
+QUICK_ARG_PARSER_FUNCTION void finishSchema(Schema& schema, const ParsingLimits& limits) {
+	schema.fingerprint = schemaFingerprint(schema);
+	schema.limits = limits;
+	schema.validDefaults = std::vector<ValidatedFlag>(schema.nullarySwitches.size() + schema.unarySwitches.size() + schema.argumentCountMax);
+}
+
+QUICK_ARG_PARSER_FUNCTION void registerSwitch(Schema& schema, bool unary, const std::string& name, char shortcut, const std::string& help,
+		const std::string& choices, const std::string& environment, bool listedInHelp) {
+	(unary ? schema.unarySwitches : schema.nullarySwitches).push_back(std::make_pair(name, shortcut));
+	(unary ? schema.unaryEnvironment : schema.nullaryEnvironment).push_back(environment);
+	if (!listedInHelp)
+		return;
+
+	std::string entry = choices.empty() ? help : help + (help.empty() ? "(" : " (") + choices + ")";
+	if (!environment.empty())
+		entry += (entry.empty() ? "[env: " : " [env: ") + environment + "]";
+	addHelpEntry(schema.help, name, shortcut, entry);
+}
+
+QUICK_ARG_PARSER_FUNCTION void registerArgument(Schema& schema, int index, bool required) {
+	if (required)
+		schema.argumentCountMin = std::max(schema.argumentCountMin, index + 1);
+	schema.argumentCountMax = std::max(schema.argumentCountMax, index + 1);
+}
+
+QUICK_ARG_PARSER_FUNCTION int switchIndex(const Schema& schema, const std::string& name, char shortcut) {
+	int index = 0;
+	for (const auto& it : schema.nullarySwitches) {
+		if (it.second == shortcut && it.first == name)
+			return index;
+		index++;
+	}
+	for (const auto& it : schema.unarySwitches) {
+		if (it.second == shortcut && it.first == name)
+			return index;
+		index++;
+	}
+	return -1;
+}
+
+QUICK_ARG_PARSER_FUNCTION const std::vector<std::string>& resolvedValues(const Schema& schema,
+		const std::vector<std::vector<std::string>>& resolved, const std::string& name, char shortcut) {
+	static const std::vector<std::string> absent;
+	const int index = switchIndex(schema, name, shortcut);
+	if (index < 0 || index >= int(resolved.size()))
+		return absent;
+	return resolved[index];
+}
+
+QUICK_ARG_PARSER_FUNCTION bool SchemaClassifier::takesValue(Token& token) const {
+	int index = 0;
+	auto find = [&] (const std::vector<std::pair<std::string, char>>& switches) {
+		for (const auto& it : switches) {
+			if (token.kind == Token::SHORT_OPTION ? it.second == token.name.data[0] : token.name == it.first)
+				return true;
+			index++;
+		}
+		return false;
+	};
+	if (find(schema->nullarySwitches)) {
+		token.option = index;
+		return false;
+	}
+	if (find(schema->unarySwitches)) {
+		token.option = index;
+		return true;
+	}
+	return false;
+}
+
+QUICK_ARG_PARSER_FUNCTION size_t nonstandardNameLength(const std::vector<std::pair<std::string, char>>& switches, const char* arg) {
+	for (const auto& it : switches) {
+		if (it.first.empty() || (it.first[0] == '-' && it.first[1] == '-'))
+			continue;
+		if (std::strncmp(arg, it.first.c_str(), it.first.size()) == 0
+				&& (arg[it.first.size()] == '\0' || arg[it.first.size()] == '='))
+			return it.first.size();
+	}
+	return 0;
+}
+
+QUICK_ARG_PARSER_FUNCTION size_t SchemaClassifier::nonstandardLength(const char* arg) const {
+	// Options like -line or /tool
+	const size_t length = nonstandardNameLength(schema->unarySwitches, arg);
+	return length ? length : nonstandardNameLength(schema->nullarySwitches, arg);
+}
+
+QUICK_ARG_PARSER_FUNCTION void resolveArguments(const Schema& schema, int argc, const char* const* argv, SpecialOptionHandler& handler,
+		std::vector<std::string>& arguments, std::vector<std::vector<std::string>>& resolved) {
+	// Sorts everything into program arguments (as opposed to switches) and values of the switches in one pass
+	const int nullaryCount = schema.nullarySwitches.size();
+	resolved.assign(nullaryCount + schema.unarySwitches.size(), std::vector<std::string>());
+	Tokenizer<SchemaClassifier> tokenizer(argc, argv, SchemaClassifier{&schema});
+	Token token;
+	while (tokenizer.next(token)) {
+		if (token.kind == Token::POSITIONAL) {
+			arguments.push_back(token.value.str());
+			continue;
+		} else if (token.kind == Token::TERMINATOR) {
+			continue;
+		} else if (token.kind == Token::LONG_OPTION) {
+			if (token.name == "--help" && !token.hasValue) {
+				handler.help();
+				continue;
+			}
+			if (token.name == "--version" && !token.hasValue && handler.version())
+				continue;
+			if (token.option < 0)
+				throw ArgumentError("Unknown switch " + token.name.str());
+		} else {
+			// Single letter switches are special only if alone, like -x
+			const char letter = token.name.data[0];
+			const bool alone = argv[token.index][2] == '\0';
+			if (alone && letter == '?') {
+				handler.help();
+				continue;
+			}
+			if (alone && letter == 'V' && handler.version())
+				continue;
+			if (token.option < 0)
+				throw ArgumentError(std::string("Unknown switch ") + letter);
+		}
+
+		if (token.option < nullaryCount) {
+			if (token.kind == Token::LONG_OPTION && token.hasValue)
+				throw ArgumentError("Switch " + token.name.str() + " does not take a value");
+			resolved[token.option].emplace_back(); // Only the number of occurrences matters
+		} else {
+			if (!token.hasValue)
+				throw ArgumentError("Switch " + token.name.str() + " requires a value");
+			resolved[token.option].push_back(token.value.str());
+		}
+	}
+
+	if (int(arguments.size()) < schema.argumentCountMin)
+		throw ArgumentError("Expected at least " + std::to_string(schema.argumentCountMin)
+				+ " arguments, got " + std::to_string(arguments.size()));
+	if (int(arguments.size()) > schema.argumentCountMax)
+		throw ArgumentError("Expected at most " + std::to_string(schema.argumentCountMax)
+				+ " arguments, got " + std::to_string(arguments.size()));
+}
+
+QUICK_ARG_PARSER_FUNCTION void resolveEnvironment(const Schema& schema, std::vector<std::vector<std::string>>& resolved) {
+	// Switches not set on the command line are filled from the environment in a single pass through it
+	if (std::all_of(schema.nullaryEnvironment.begin(), schema.nullaryEnvironment.end(), [] (const std::string& it) { return it.empty(); })
+			&& std::all_of(schema.unaryEnvironment.begin(), schema.unaryEnvironment.end(), [] (const std::string& it) { return it.empty(); }))
+		return;
+#if defined(_WIN32)
+	char** variables = _environ;
+#elif defined(__APPLE__)
+	char** variables = *_NSGetEnviron();
+#else
+	char** variables = environ;
+#endif
+	const int nullaryCount = schema.nullarySwitches.size();
+	for (char** it = variables; it && *it; it++) {
+		const char* separator = std::strchr(*it, '=');
+		if (!separator)
+			continue;
+		const size_t nameLength = separator - *it;
+		const char* value = separator + 1;
+		for (int i = 0; i < int(resolved.size()); i++) {
+			const std::string& name = i < nullaryCount ? schema.nullaryEnvironment[i] : schema.unaryEnvironment[i - nullaryCount];
+			if (name.size() != nameLength || !resolved[i].empty() || std::memcmp(name.data(), *it, nameLength) != 0)
+				continue;
+			if (i >= nullaryCount) {
+				resolved[i].push_back(value);
+				continue;
+			}
+			static const char* const negatives[] = {"", "0", "false", "no", "off"};
+			auto isNegative = [value] (const char* negative) {
+				int j = 0;
+				while (negative[j] != '\0' && std::tolower(static_cast<unsigned char>(value[j])) == negative[j])
+					j++;
+				return negative[j] == '\0' && value[j] == '\0';
+			};
+			if (std::none_of(std::begin(negatives), std::end(negatives), isNegative))
+				resolved[i].emplace_back(); // Set unless it's clearly negative
+		}
+	}
+}
+
+QUICK_ARG_PARSER_FUNCTION std::vector<std::string> splitCommandLine(const std::string& commandLine) {
+	// Splits by whitespace, respects quotes and backslash escapes, lines starting with # are comments
+	std::vector<std::string> tokens;
+	std::string token;
+	bool inToken = false;
+	char quote = '\0';
+	for (int i = 0; i < int(commandLine.size()); i++) {
+		const char letter = commandLine[i];
+		if (quote != '\0') {
+			if (letter == quote)
+				quote = '\0';
+			else if (letter == '\\' && quote == '"' && i + 1 < int(commandLine.size())
+					&& (commandLine[i + 1] == '"' || commandLine[i + 1] == '\\'))
+				token += commandLine[++i];
+			else
+				token += letter;
+		} else if (letter == ' ' || letter == '\t' || letter == '\n' || letter == '\r') {
+			if (inToken)
+				tokens.push_back(std::move(token));
+			token.clear();
+			inToken = false;
+		} else if (letter == '#' && !inToken) {
+			while (i + 1 < int(commandLine.size()) && commandLine[i + 1] != '\n')
+				i++;
+		} else {
+			inToken = true;
+			if (letter == '"' || letter == '\'')
+				quote = letter;
+			else if (letter == '\\' && i + 1 < int(commandLine.size()))
+				token += commandLine[++i];
+			else
+				token += letter;
+		}
+	}
+	if (quote != '\0')
+		throw ArgumentError("Unterminated quote in " + commandLine);
+	if (inToken)
+		tokens.push_back(std::move(token));
+	return tokens;
+}
+
+QUICK_ARG_PARSER_FUNCTION bool readFile(const std::string& path, std::string& contents) {
+	FILE* file = std::fopen(path.c_str(), "rb");
+	if (!file)
+		return false;
+	contents.clear();
+	char buffer[4096];
+	size_t got = 0;
+	while ((got = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+		contents.append(buffer, got);
+	const bool failed = std::ferror(file);
+	std::fclose(file);
+	return !failed;
+}
+
+#ifdef QUICK_ARG_PARSER_THREADS
+// Threads kept for parallelFor(), so that parsing doesn't start new threads every time
+class ThreadPool {
+	struct Batch {
+		const ParallelJob* job;
+		size_t count;
+		std::atomic<size_t> next;
+		int active = 0; // Threads helping with it
+		std::condition_variable finished;
+		Batch(const ParallelJob* job, size_t count) : job(job), count(count), next(0) {}
+		void run() {
+			for (size_t i = next++; i < count; i = next++)
+				(*job)(i);
+		}
+	};
+
+	constexpr static size_t maxThreads = 64;
+	std::mutex _mutex;
+	std::condition_variable _wakeUp;
+	std::vector<Batch*> _queue; // One entry for each thread that can help
+	std::vector<std::thread> _threads;
+	bool _stopping = false;
+
+	void work() {
+		std::unique_lock<std::mutex> lock(_mutex);
+		while (true) {
+			_wakeUp.wait(lock, [this] { return _stopping || !_queue.empty(); });
+			if (_stopping)
+				return;
+			Batch* batch = _queue.back();
+			_queue.pop_back();
+			batch->active++;
+			lock.unlock();
+			batch->run();
+			lock.lock();
+			if (--batch->active == 0)
+				batch->finished.notify_all();
+		}
+	}
+
+public:
+	void run(size_t count, size_t threadCount, const ParallelJob& job) {
+		Batch batch(&job, count);
+		const size_t helpers = std::min(threadCount, size_t(maxThreads)) - 1; // Copied, binding it to a reference would need a definition in C++11
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			while (_threads.size() < helpers)
+				_threads.emplace_back([this] { work(); });
+			_queue.insert(_queue.end(), helpers, &batch);
+		}
+		_wakeUp.notify_all();
+		batch.run();
+
+		// Helpers that didn't start are not needed any more, the others have to finish their items
+		std::unique_lock<std::mutex> lock(_mutex);
+		_queue.erase(std::remove(_queue.begin(), _queue.end(), &batch), _queue.end());
+		batch.finished.wait(lock, [&batch] { return batch.active == 0; });
+	}
+
+	~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stopping = true;
+		}
+		_wakeUp.notify_all();
+		for (auto& it : _threads)
+			it.join();
+	}
+};
+#endif
+
+QUICK_ARG_PARSER_FUNCTION void parallelFor(size_t count, size_t threadCount, const ParallelJob& job) {
+#ifdef QUICK_ARG_PARSER_THREADS
+	threadCount = std::min(count, threadCount);
+	if (threadCount > 1) {
+		static ThreadPool pool;
+		pool.run(count, threadCount, job);
+		return;
+	}
+#else
+	(void)threadCount;
+#endif
+	for (size_t i = 0; i < count; i++)
+		job(i);
+}
+
+QUICK_ARG_PARSER_FUNCTION size_t hardwareThreads() {
+#ifdef QUICK_ARG_PARSER_THREADS
+	return std::max<size_t>(1, std::thread::hardware_concurrency());
+#else
+	return 1;
+#endif
+}
+
+QUICK_ARG_PARSER_FUNCTION void runValidations(const std::vector<DeferredValidation>& validations, size_t threadCount) {
+	std::vector<std::string> errors(validations.size());
+	// Validators are expected to be waiting for I/O rather than computing, so there can be more threads than cores
+	parallelFor(validations.size(), threadCount, makeJob([&] (size_t index) {
+		try {
+			if (!(*validations[index].check)())
+				errors[index] = "Invalid value of argument " + validations[index].name;
+		} catch (std::exception& error) {
+			errors[index] = error.what();
+		} catch (...) {
+			errors[index] = "Invalid value of argument " + validations[index].name;
+		}
+	}));
+	std::string joined;
+	for (const std::string& it : errors) {
+		if (!it.empty())
+			joined += (joined.empty() ? "" : "; ") + it;
+	}
+	if (!joined.empty())
+		throw ArgumentError(joined);
+}
+
+QUICK_ARG_PARSER_FUNCTION uint64_t hashBytes(const char* data, size_t size, uint64_t hash) {
+	// FNV-1a
+	for (size_t i = 0; i < size; i++) {
+		hash ^= uint8_t(data[i]);
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+QUICK_ARG_PARSER_FUNCTION uint64_t schemaFingerprint(const Schema& schema) {
+	uint64_t hash = hashBytes(nullptr, 0);
+	auto add = [&] (char kind, const std::string& name, char shortcut) {
+		hash = hashBytes(&kind, 1, hash);
+		hash = hashBytes(name.c_str(), name.size() + 1, hash);
+		hash = hashBytes(&shortcut, 1, hash);
+	};
+	for (const auto& it : schema.nullarySwitches)
+		add('n', it.first, it.second);
+	for (const auto& it : schema.unarySwitches)
+		add('u', it.first, it.second);
+	for (const auto& it : schema.confusingSwitches)
+		add('c', it, '\0');
+	const int32_t counts[2] = { schema.argumentCountMin, schema.argumentCountMax };
+	return hashBytes(reinterpret_cast<const char*>(counts), sizeof(counts), hash);
+}
+
+// Snapshot format: magic, format version, schema fingerprint, program name, arguments, values of all switches
+// Numbers are little endian, strings and lists are preceded by their 32 bit sizes
+constexpr char snapshotMagic[] = "QAPS";
+constexpr uint32_t snapshotFormatVersion = 1;
+
+QUICK_ARG_PARSER_FUNCTION std::string writeSnapshot(const Schema& schema, const std::string& programName,
+		const std::vector<std::string>& arguments, const std::vector<std::vector<std::string>>& resolved) {
+	std::string written(snapshotMagic, 4);
+	auto writeNumber = [&] (uint64_t number, int bytes) {
+		for (int i = 0; i < bytes; i++)
+			written += char((number >> (i * 8)) & 0xff);
+	};
+	auto writeStrings = [&] (const std::vector<std::string>& strings) {
+		writeNumber(strings.size(), 4);
+		for (const std::string& it : strings) {
+			writeNumber(it.size(), 4);
+			written += it;
+		}
+	};
+	writeNumber(snapshotFormatVersion, 4);
+	writeNumber(schema.fingerprint, 8);
+	writeNumber(programName.size(), 4);
+	written += programName;
+	writeStrings(arguments);
+	writeNumber(resolved.size(), 4);
+	for (const auto& it : resolved)
+		writeStrings(it);
+	return written;
+}
+
+QUICK_ARG_PARSER_FUNCTION void readSnapshot(const Schema& schema, Snapshot snapshot, std::string& programName,
+		std::vector<std::string>& arguments, std::vector<std::vector<std::string>>& resolved) {
+	size_t position = 0;
+	auto require = [&] (size_t bytes) {
+		if (snapshot.size - position < bytes)
+			throw ArgumentError("Snapshot of arguments is truncated");
+	};
+	auto readNumber = [&] (int bytes) {
+		require(bytes);
+		uint64_t number = 0;
+		for (int i = 0; i < bytes; i++)
+			number |= uint64_t(uint8_t(snapshot.data[position + i])) << (i * 8);
+		position += bytes;
+		return number;
+	};
+	auto readString = [&] () {
+		const size_t size = readNumber(4);
+		require(size);
+		position += size;
+		return std::string(snapshot.data + position - size, size);
+	};
+	auto readStrings = [&] (std::vector<std::string>& strings) {
+		const size_t count = readNumber(4);
+		strings.clear();
+		strings.reserve(std::min(count, snapshot.size / 4));
+		for (size_t i = 0; i < count; i++)
+			strings.push_back(readString());
+	};
+
+	require(4);
+	if (std::string(snapshot.data, 4) != std::string(snapshotMagic, 4))
+		throw ArgumentError("Data is not a snapshot of arguments");
+	position += 4;
+	if (readNumber(4) != snapshotFormatVersion)
+		throw ArgumentError("Snapshot of arguments has an unsupported format version");
+	if (readNumber(8) != schema.fingerprint)
+		throw ArgumentError("Snapshot of arguments was created for different options");
+	programName = readString();
+	readStrings(arguments);
+	const size_t switchCount = readNumber(4);
+	if (switchCount != schema.nullarySwitches.size() + schema.unarySwitches.size())
+		throw ArgumentError("Snapshot of arguments was created for different options");
+	resolved.resize(switchCount);
+	for (auto& it : resolved)
+		readStrings(it);
+	if (position != snapshot.size)
+		throw ArgumentError("Snapshot of arguments has trailing data");
+}
+
+QUICK_ARG_PARSER_FUNCTION std::vector<std::string> canonicalCommandLine(const Schema& schema, const std::string& programName,
+		const std::vector<std::string>& arguments, const std::vector<std::vector<std::string>>& resolved) {
+	std::vector<std::string> made = { programName };
+	auto switchName = [] (const std::pair<std::string, char>& switchNames) {
+		return switchNames.first.empty() ? std::string("-") + switchNames.second : switchNames.first;
+	};
+	for (int i = 0; i < int(schema.nullarySwitches.size()) && i < int(resolved.size()); i++) {
+		for (int j = 0; j < int(resolved[i].size()); j++)
+			made.push_back(switchName(schema.nullarySwitches[i]));
+	}
+	for (int i = 0; i < int(schema.unarySwitches.size()) && i + schema.nullarySwitches.size() < resolved.size(); i++) {
+		for (const std::string& value : resolved[i + schema.nullarySwitches.size()])
+			made.push_back(switchName(schema.unarySwitches[i]) + '=' + value);
+	}
+	if (!arguments.empty()) {
+		made.push_back("--");
+		made.insert(made.end(), arguments.begin(), arguments.end());
+	}
+	return made;
+}
+
+
+template <typename Untyped>
+struct CacheIndex<Untyped>::State {
+	struct Entry {
+		uint64_t hash;
+		std::vector<std::string> tokens;
+		std::vector<std::string> environment;
+		std::shared_ptr<Untyped> parsed;
+	};
+	using Entries = std::list<Entry>;
+
+	const size_t capacity;
+	std::vector<std::string> variables; // Environment variables read by the class, their values are a part of the key
+	Entries entries; // The most recently used first
+	std::unordered_multimap<uint64_t, typename Entries::iterator> index;
+	size_t hits = 0;
+	size_t misses = 0;
+#ifdef QUICK_ARG_PARSER_THREADS
+	using Lock = std::lock_guard<std::mutex>;
+	std::mutex mutex;
+#else
+	struct Lock {
+		Lock(int) {}
+	};
+	int mutex = 0;
+#endif
+
+	State(size_t capacity) : capacity(capacity) {}
+
+	static bool sameTokens(const Entry& entry, int argc, char** argv, const std::vector<std::string>& environment) {
+		if (int(entry.tokens.size()) != argc || entry.environment != environment)
+			return false;
+		for (int i = 0; i < argc; i++) {
+			if (entry.tokens[i] != argv[i])
+				return false;
+		}
+		return true;
+	}
+
+	std::shared_ptr<Untyped> find(const Key& key, int argc, char** argv) {
+		auto range = index.equal_range(key.hash);
+		for (auto it = range.first; it != range.second; ++it) {
+			if (sameTokens(*it->second, argc, argv, key.environment)) {
+				entries.splice(entries.begin(), entries, it->second);
+				return it->second->parsed;
+			}
+		}
+		return nullptr;
+	}
+};
+
+template <typename Untyped>
+CacheIndex<Untyped>::CacheIndex(const Schema& schema, size_t capacity) : _state(new State(std::max<size_t>(capacity, 1))) {
+	for (const auto& variables : {&schema.nullaryEnvironment, &schema.unaryEnvironment}) {
+		for (const std::string& it : *variables) {
+			if (!it.empty())
+				_state->variables.push_back(it);
+		}
+	}
+}
+
+template <typename Untyped>
+CacheIndex<Untyped>::~CacheIndex() = default;
+
+template <typename Untyped>
+typename CacheIndex<Untyped>::Key CacheIndex<Untyped>::makeKey(int argc, char** argv) const {
+	Key key;
+	key.environment.reserve(_state->variables.size());
+	for (const std::string& it : _state->variables) {
+		const char* value = std::getenv(it.c_str());
+		key.environment.push_back(value ? '=' + std::string(value) : std::string()); // An unset variable differs from an empty one
+	}
+	key.hash = hashBytes(nullptr, 0);
+	for (int i = 0; i < argc; i++)
+		key.hash = hashBytes(argv[i], std::strlen(argv[i]) + 1, key.hash); // Including the terminator as separator
+	for (const std::string& it : key.environment)
+		key.hash = hashBytes(it.c_str(), it.size() + 1, key.hash);
+	return key;
+}
+
+template <typename Untyped>
+std::shared_ptr<Untyped> CacheIndex<Untyped>::find(const Key& key, int argc, char** argv) {
+	typename State::Lock lock(_state->mutex);
+	std::shared_ptr<Untyped> found = _state->find(key, argc, argv);
+	if (found)
+		_state->hits++;
+	else
+		_state->misses++;
+	return found;
+}
+
+template <typename Untyped>
+std::shared_ptr<Untyped> CacheIndex<Untyped>::insert(const Key& key, int argc, char** argv, std::shared_ptr<Untyped> parsed) {
+	typename State::Lock lock(_state->mutex);
+	std::shared_ptr<Untyped> found = _state->find(key, argc, argv);
+	if (found)
+		return found; // Parsed concurrently by another thread
+	typename State::Entries& entries = _state->entries;
+	entries.push_front(typename State::Entry{key.hash, std::vector<std::string>(argv, argv + argc), key.environment, parsed});
+	_state->index.emplace(key.hash, entries.begin());
+	if (entries.size() > _state->capacity) {
+		auto range = _state->index.equal_range(entries.back().hash);
+		for (auto it = range.first; it != range.second; ++it) {
+			if (it->second == std::prev(entries.end())) {
+				_state->index.erase(it);
+				break;
+			}
+		}
+		entries.pop_back();
+	}
+	return parsed;
+}
+
+template <typename Untyped>
+size_t CacheIndex<Untyped>::hits() const {
+	typename State::Lock lock(_state->mutex);
+	return _state->hits;
+}
+
+template <typename Untyped>
+size_t CacheIndex<Untyped>::misses() const {
+	typename State::Lock lock(_state->mutex);
+	return _state->misses;
+}
+
+template <typename Untyped>
+size_t CacheIndex<Untyped>::size() const {
+	typename State::Lock lock(_state->mutex);
+	return _state->entries.size();
+}
+
+template <typename Untyped>
+void CacheIndex<Untyped>::clear() {
+	typename State::Lock lock(_state->mutex);
+	_state->entries.clear();
+	_state->index.clear();
+}
+
+#endif
+
+} // namespace
+
+// The tokenizer that MainArguments uses, it can also be used directly to stream through the arguments
+using QuickArgParserInternals::ArgView;
+using QuickArgParserInternals::Token;
+using QuickArgParserInternals::NoValueOptions;
+using QuickArgParserInternals::Tokenizer;
+
+// Finds a few options before the class with all options can be created, for example to set up logging first,
+// without knowing the other options and without allocating, a short option is recognised only as the first letter
+// of a group like -t4 or -t 4 because it's unknown which options the group contains
+class EarlyArguments {
+	int _argc;
+	char** _argv;
+	int _end; // Options are not looked for behind --
+
+	// Returns the value or null if it's missing, found is set if the option is there
+	const char* find(const char* name, char shortcut, bool& found) const {
+		const size_t nameLength = name ? std::strlen(name) : 0;
+		for (int i = 1; i < _end; i++) {
+			const char* arg = _argv[i];
+			const char* rest = nullptr;
+			if (arg[0] != '-')
+				continue;
+			if (arg[1] == '-') {
+				if (nameLength > 0 && std::strncmp(arg + 2, name, nameLength) == 0
+						&& (arg[nameLength + 2] == '\0' || arg[nameLength + 2] == '='))
+					rest = arg + nameLength + 2;
+			} else if (shortcut != '\0' && arg[1] == shortcut) {
+				rest = arg + 2;
+			}
+			if (!rest)
+				continue;
+			found = true;
+			if (*rest == '=')
+				return rest + 1;
+			if (*rest != '\0')
+				return rest;
+			return i + 1 < _end ? _argv[i + 1] : nullptr;
+		}
+		return nullptr;
+	}
+
+public:
+	EarlyArguments(int argc, char** argv) : _argc(argc), _argv(argv), _end(argc) {
+		for (int i = 1; i < argc; i++) {
+			if (std::strcmp(argv[i], "--") == 0) {
+				_end = i;
+				break;
+			}
+		}
+	}
+
+	// The name is without the leading dashes, can be null if there's only the shortcut
+	template <typename T>
+	T option(const char* name, char shortcut, T defaultValue) const {
+		bool found = false;
+		const char* value = find(name, shortcut, found);
+		if (!found)
+			return defaultValue;
+		if (!value)
+			throw QuickArgParserInternals::ArgumentError(std::string("Switch ")
+					+ (name ? std::string("--") + name : std::string("-") + shortcut) + " requires a value");
+		return QuickArgParserInternals::ArgConverter<T>::deserialise(std::string(value));
+	}
+
+	// For options that don't take a value
+	bool has(const char* name, char shortcut = '\0') const {
+		bool found = false;
+		for (int i = 1; i < _end && !found; i++) {
+			const char* arg = _argv[i];
+			if (arg[0] == '-' && arg[1] == '-')
+				found = name && std::strcmp(arg + 2, name) == 0;
+			else
+				found = arg[0] == '-' && shortcut != '\0' && arg[1] == shortcut;
+		}
+		return found;
+	}
+
+	int argc() const {
+		return _argc;
+	}
+	char** argv() const {
+		return _argv;
+	}
+};
+
+template <typename Child>
+class ParseCache;
+#ifdef QUICK_ARG_PARSER_THREADS
+template <typename Child>
+class HotReloadedArguments;
+#endif
+
+template <typename Child>
+class MainArguments {
+	std::string _programName;
+	friend class ParseCache<Child>;
+#ifdef QUICK_ARG_PARSER_THREADS
+	friend class HotReloadedArguments<Child>;
+#endif
+	
+	enum InitialisationStep {
+		UNINITIALISED,
+		INITIALISING,
+		INITIALISED
+	};
+	struct Singleton : QuickArgParserInternals::Schema {
+		InitialisationStep initialisationState = UNINITIALISED;
+	};
+	static Singleton& singleton() {
+		static Singleton instance;
+		return instance;
+	}
+	
+	using DummyValidator = QuickArgParserInternals::DummyValidator;
+public:
+	template <typename T> using Optional = QuickArgParserInternals::Optional<T>;
+	using ParsingLimits = QuickArgParserInternals::ParsingLimits;
+	using Snapshot = QuickArgParserInternals::Snapshot;
+	template <size_t Count> using FlagSet = QuickArgParserInternals::FlagSet<Count>;
+	template <typename Bytes> using Hex = QuickArgParserInternals::Hex<Bytes>;
+	template <typename Bytes> using Base64 = QuickArgParserInternals::Base64<Bytes>;
+#if __cplusplus >= 201402L
+	template <typename T> using EnumFlags = QuickArgParserInternals::EnumFlags<T>;
+#endif
+	MainArguments() = default;
+	MainArguments(int argc, char** argv) : _programName(argv[0]), _deferredValidations(deferredValidationsTarget()) {
+		using namespace QuickArgParserInternals;
+		deferredValidationsTarget() = nullptr;
+		initialiseSchema();
+		checkLimits(singleton().limits, argc, argv);
+		if (singleton().initialisationState == INITIALISED) {
+			struct Handler : SpecialOptionHandler {
+				MainArguments* self;
+				Handler(MainArguments* self) : self(self) {}
+				void help() override {
+					if (specialOptionsRejected())
+						throw ArgumentError("Help cannot be printed here");
+					const std::string preface = HelpProvider<Child>::get(singleton(), self->_programName);
+					OutputSink<Child>::print(preface + '\n' + singleton().help + '\n');
+					
+					QuickArgParserInternals::OnHelpCallback<Child>::on(static_cast<Child*>(self), [] { std::exit(0); });
+				}
+				bool version() override {
+					if (VersionPrinter<Child>::known && specialOptionsRejected())
+						throw ArgumentError("Version cannot be printed here");
+					if (!QuickArgParserInternals::VersionPrinter<Child>::print())
+						return false; // Returns false if the version is not known, leading to no action if found
+						
+					QuickArgParserInternals::OnVersionCallback<Child>::on(static_cast<Child*>(self), [] { std::exit(0); });
+					return true;
 				}
+			} handler(this);
+
+			resolveArguments(singleton(), argc, argv, handler, arguments, _resolved);
+			resolveEnvironment(singleton(), _resolved);
+		}
+	}
+	// Completes parsing of arguments from which some options were already read
+	MainArguments(const EarlyArguments& early) : MainArguments(early.argc(), early.argv()) {}
+	// Recreates the parsed state from a snapshot without looking for the options again
+	MainArguments(Snapshot snapshot) : _deferredValidations(deferredValidationsTarget()) {
+		deferredValidationsTarget() = nullptr;
+		initialiseSchema();
+		QuickArgParserInternals::readSnapshot(singleton(), snapshot, _programName, arguments, _resolved);
+	}
+	std::vector<std::string> arguments;
+
+	// Like the constructor, but validators set through concurrentValidator() run concurrently after everything is parsed
+	// (if QUICK_ARG_PARSER_THREADS is defined) and all their errors are reported together
+	static Child parse(int argc, char** argv) {
+		return parseValidating(argc, argv, QuickArgParserInternals::defaultValidationThreads);
+	}
+
+	struct BatchResult {
+		std::unique_ptr<Child> parsed; // Null if parsing failed
+		std::string error;
+	};
+
+	// Parses many command lines, each starting with the program name, on threadCount threads (0 means one per core)
+	// if QUICK_ARG_PARSER_THREADS is defined, results are in the same order, help and version are reported as errors
+	static std::vector<BatchResult> parseBatch(const std::vector<std::vector<std::string>>& commandLines, size_t threadCount = 0) {
+		return parseBatch(commandLines.size(), threadCount, [&] (size_t index) -> const std::vector<std::string>& {
+			return commandLines[index];
+		});
+	}
+
+	// Like the above, but the command lines are written as in a shell, see splitCommandLine()
+	static std::vector<BatchResult> parseBatch(const std::vector<std::string>& commandLines, size_t threadCount = 0) {
+		return parseBatch(commandLines.size(), threadCount, [&] (size_t index) {
+			return QuickArgParserInternals::splitCommandLine(commandLines[index]);
+		});
+	}
+
+	// The result can be sent to another process, it can read it only if it was compiled with the same options
+	std::string snapshot() const {
+		return QuickArgParserInternals::writeSnapshot(singleton(), _programName, arguments, _resolved);
+	}
+
+	// The shortest command line that would be parsed into the same values, including the program name
+	std::vector<std::string> canonicalCommandLine() const {
+		return QuickArgParserInternals::canonicalCommandLine(singleton(), _programName, arguments, _resolved);
+	}
+
+	// Lists the options whose values differ between the two instances
+	std::vector<std::string> changedOptions(const MainArguments& other) const {
+		std::vector<std::string> changed;
+		auto compare = [&] (const std::vector<std::pair<std::string, char>>& switches) {
+			for (const auto& it : switches) {
+				if (findOption(it.first, it.second) != other.findOption(it.first, it.second))
+					changed.push_back(it.first.empty() ? std::string("-") + it.second : it.first);
 			}
+		};
+		compare(singleton().nullarySwitches);
+		compare(singleton().unarySwitches);
+		return changed;
+	}
+
+private:
+	std::vector<std::vector<std::string>> _resolved; // Values of nullary switches followed by values of unary switches
+	std::vector<QuickArgParserInternals::DeferredValidation>* _deferredValidations = nullptr; // Set only while parse() runs
+
+	static Child parseValidating(int argc, char** argv, size_t validationThreads) {
+		std::vector<QuickArgParserInternals::DeferredValidation> validations;
+		struct TargetReset {
+			~TargetReset() {
+				deferredValidationsTarget() = nullptr;
+			}
+		} targetReset;
+		deferredValidationsTarget() = &validations;
+		Child made = QuickArgParserInternals::makeArguments<Child>(argc, argv);
+		static_cast<MainArguments&>(made)._deferredValidations = nullptr;
+		QuickArgParserInternals::runValidations(validations, validationThreads);
+		return made;
+	}
+
+	template <typename TokensOf>
+	static std::vector<BatchResult> parseBatch(size_t count, size_t threadCount, const TokensOf& tokensOf) {
+		initialiseSchema(); // Before the threads start, see initialiseSchema()
+		std::vector<BatchResult> results(count);
+		QuickArgParserInternals::parallelFor(count, threadCount ? threadCount : QuickArgParserInternals::hardwareThreads(),
+				QuickArgParserInternals::makeJob([&] (size_t index) {
+			SpecialOptionsRejection rejection;
+			try {
+				const auto& tokens = tokensOf(index);
+				if (tokens.empty())
+					throw QuickArgParserInternals::ArgumentError("Missing program name");
+				std::vector<char*> argv;
+				for (const std::string& it : tokens)
+					argv.push_back(const_cast<char*>(it.c_str())); // Never written into
+				argv.push_back(nullptr);
+				// The batch is already parallel, so concurrent validators run on this thread
+				results[index].parsed.reset(new Child(parseValidating(int(tokens.size()), argv.data(), 1)));
+			} catch (std::exception& error) {
+				results[index].error = error.what();
+			} catch (...) {
+				results[index].error = "Unknown error";
+			}
+		}));
+		return results;
+	}
+
+	// Help and version can't print and exit the program while it is busy with something else, so they become errors
+	static bool& specialOptionsRejected() {
+		static thread_local bool rejected = false;
+		return rejected;
+	}
+	struct SpecialOptionsRejection {
+		bool previous = specialOptionsRejected();
+		SpecialOptionsRejection() {
+			specialOptionsRejected() = true;
+		}
+		~SpecialOptionsRejection() {
+			specialOptionsRejected() = previous;
+		}
+	};
+
+	static std::vector<QuickArgParserInternals::DeferredValidation>*& deferredValidationsTarget() {
+		static thread_local std::vector<QuickArgParserInternals::DeferredValidation>* target = nullptr;
+		return target;
+	}
+
+	// Not thread safe, callers that parse on multiple threads must call it before they start
+	static void initialiseSchema() {
+		if (singleton().initialisationState == UNINITIALISED) {
+			// When first created, create temporarily another instance to explore what are the members
+			singleton().initialisationState = INITIALISING;
+
+			Child investigator;
+			// This will fill the static variables
+			QuickArgParserInternals::finishSchema(singleton(), QuickArgParserInternals::LimitsProvider<Child>::get());
+
+			singleton().initialisationState = INITIALISED;
 		}
-		
-		return collected;
+	}
+	
+	static int switchIndex(const std::string& argument, char shortcut) {
+		return QuickArgParserInternals::switchIndex(singleton(), argument, shortcut);
+	}
+
+	const std::vector<std::string>& findOption(const std::string& argument, char shortcut) const {
+		return QuickArgParserInternals::resolvedValues(singleton(), _resolved, argument, shortcut);
+	}
+
+	static QuickArgParserInternals::ValidatedFlag* validatedDefault(int defaultIndex) {
+		if (defaultIndex >= 0 && defaultIndex < int(singleton().validDefaults.size()))
+			return &singleton().validDefaults[defaultIndex];
+		return nullptr;
+	}
+
+	template <typename T>
+	void validate(const DummyValidator&, const T&, const std::string&, int) const {}
+
+	// Default values are validated only once, defaultIndex is negative if the value is not a default
+	template <typename Validator, typename T>
+	void validate(const Validator& validator, const T& value, const std::string& name, int defaultIndex) const {
+		QuickArgParserInternals::ValidatedFlag* validDefault = validatedDefault(defaultIndex);
+		if (validDefault && validDefault->get())
+			return;
+		if (!QuickArgParserInternals::ValidatorUser<Validator>::useValidator(validator, value))
+			throw QuickArgParserInternals::ArgumentError("Invalid value of argument " + name);
+		if (validDefault)
+			validDefault->set();
+	}
+
+	template <typename Validator, typename T>
+	void validate(const QuickArgParserInternals::Concurrent<Validator>& concurrent, const T& value, const std::string& name,
+			int defaultIndex) const {
+		QuickArgParserInternals::ValidatedFlag* validDefault = validatedDefault(defaultIndex);
+		if (validDefault && validDefault->get())
+			return;
+		if (_deferredValidations && defer(concurrent.validator, value, name, validDefault, std::is_copy_constructible<T>()))
+			return;
+		validate(concurrent.validator, value, name, defaultIndex);
+	}
+
+	template <typename Validator, typename T>
+	bool defer(const Validator& validator, const T& value, const std::string& name, QuickArgParserInternals::ValidatedFlag* validDefault,
+			std::true_type) const {
+		using Check = QuickArgParserInternals::DeferredValidator<Validator, T>;
+		_deferredValidations->push_back({std::unique_ptr<Check>(new Check(validator, value, validDefault)), name});
+		return true;
+	}
+
+	template <typename Validator, typename T>
+	bool defer(const Validator&, const T&, const std::string&, QuickArgParserInternals::ValidatedFlag*, std::false_type) const {
+		return false; // The value can't be kept for later, so it's validated immediately
 	}
 	
 protected:	
@@ -590,25 +2382,19 @@ protected:
 		const char shortcut;
 		const std::string help;
 		Validator validator;
-		GrabberBase(const MainArguments* parent, const std::string& name, char shortcut, const std::string& help, const Validator& validator)
-				: name(name), parent(parent), shortcut(shortcut), help(help), validator(validator) {}
+		const std::string environment;
+		GrabberBase(const MainArguments* parent, const std::string& name, char shortcut, const std::string& help, const Validator& validator,
+				const std::string& environment = "")
+				: name(name), parent(parent), shortcut(shortcut), help(help), validator(validator), environment(environment) {}
 
-		void addHelpEntry() const {
-			if (QuickArgParserInternals::HasHelpOptionsProvider<Child>::value)
-				return;
-
-			if (shortcut != '\0')
-				parent->singleton().help << '-' << shortcut;
-			parent->singleton().help << '\t';
-			if (!name.empty())
-				parent->singleton().help << name;
-			parent->singleton().help << "\t " << help << std::endl;
+		void registerSwitch(bool unary, const std::string& choices = "") const {
+			QuickArgParserInternals::registerSwitch(parent->singleton(), unary, name, shortcut, help, choices, environment,
+					!QuickArgParserInternals::HasHelpOptionsProvider<Child>::value);
 		}
 	public:
 		operator bool() const {
 			if (parent->singleton().initialisationState == INITIALISING) {
-				parent->singleton().nullarySwitches.push_back(std::make_pair(name, shortcut));
-				addHelpEntry();
+				registerSwitch(false);
 				return false;
 			}
 			return !parent->findOption(name, shortcut).empty();
@@ -616,8 +2402,7 @@ protected:
 
 		operator std::vector<bool>() const {
 			if (parent->singleton().initialisationState == INITIALISING) {
-				parent->singleton().nullarySwitches.push_back(std::make_pair(name, shortcut));
-				addHelpEntry();
+				registerSwitch(false);
 				return std::vector<bool>();
 			}
 			return std::vector<bool>(parent->findOption(name, shortcut).size(), true);
@@ -630,24 +2415,20 @@ protected:
 #endif
 		T getOption(T defaultValue) const {
 			if (parent->singleton().initialisationState == INITIALISING) {
-				parent->singleton().unarySwitches.push_back(std::make_pair(name, shortcut));
-				addHelpEntry();
+				registerSwitch(true, QuickArgParserInternals::ChoicesProvider<T>::get());
 				return defaultValue;
 			}
 			
-			auto validate = [&] (const T& value) {
-				if (!QuickArgParserInternals::ValidatorUser<Validator>::useValidator(validator, value)) {
-					throw QuickArgParserInternals::ArgumentError("Invalid value of argument " + name);
-				}
-			};
-			const auto found = parent->findOption(name, shortcut);
+			const auto& found = parent->findOption(name, shortcut);
 			
 			if (!found.empty()) {
+				if (QuickArgParserInternals::Demultiplexer<T>::isList)
+					QuickArgParserInternals::checkListLimit(parent->singleton().limits, found, name);
 				auto obtained = QuickArgParserInternals::Demultiplexer<T>::deserialise(found);
-				validate(obtained);
+				parent->validate(validator, obtained, name, -1);
 				return obtained;
 			}
-			validate(defaultValue);
+			parent->validate(validator, defaultValue, name, switchIndex(name, shortcut));
 			return defaultValue;
 		}
 	};
@@ -658,8 +2439,8 @@ protected:
 		using Base = GrabberBase<Validator>;
 	public:
 		GrabberDefaulted(const MainArguments* parent, const std::string& name, char shortcut,
-				const std::string& help, Validator validator, Default defaultValue)
-				: Base(parent, name, shortcut, help, validator), defaultValue(defaultValue) {}
+				const std::string& help, Validator validator, const std::string& environment, Default defaultValue)
+				: Base(parent, name, shortcut, help, validator, environment), defaultValue(defaultValue) {}
 #if _MSC_VER && !__INTEL_COMPILER
 		template <typename T, typename std::enable_if<QuickArgParserInternals::StringFilterOk<T>::value
 				&& !std::is_same<T, bool>::value>::type* = nullptr>
@@ -680,7 +2461,7 @@ protected:
 		using Base::GrabberBase;
 		template <typename Default>
 		GrabberDefaulted<Default, Validator> operator=(Default defaultValue) {
-			return {Base::parent, Base::name, Base::shortcut, Base::help, Base::validator, defaultValue};
+			return {Base::parent, Base::name, Base::shortcut, Base::help, Base::validator, Base::environment, defaultValue};
 		}
 		
 #if _MSC_VER && !__INTEL_COMPILER
@@ -696,7 +2477,20 @@ protected:
 		template <typename NewValidator>
 		Grabber<NewValidator> validator(const NewValidator& newValidator) {
 			return {Base::parent, Base::name, Base::shortcut,
-					Base::help, newValidator};
+					Base::help, newValidator, Base::environment};
+		}
+		
+		// For slow validators, they run concurrently if the class is created through parse()
+		template <typename NewValidator>
+		Grabber<QuickArgParserInternals::Concurrent<NewValidator>> concurrentValidator(const NewValidator& newValidator) {
+			return {Base::parent, Base::name, Base::shortcut,
+					Base::help, QuickArgParserInternals::Concurrent<NewValidator>{newValidator}, Base::environment};
+		}
+
+		// The value is read from this environment variable if the option is not on the command line
+		Grabber environment(const std::string& variable) {
+			return {Base::parent, Base::name, Base::shortcut,
+					Base::help, Base::validator, variable};
 		}
 	};
 
@@ -713,6 +2507,42 @@ protected:
 		return Grabber<DummyValidator>(this, name, shortcut, help, DummyValidator{});
 	}
 
+	class FlagGrabber {
+		const MainArguments* parent;
+		const std::vector<QuickArgParserInternals::Flag> declared;
+	public:
+		FlagGrabber(const MainArguments* parent, std::initializer_list<QuickArgParserInternals::Flag> declared)
+				: parent(parent), declared(declared) {}
+
+		template <size_t Count>
+		operator QuickArgParserInternals::FlagSet<Count>() const {
+			QuickArgParserInternals::FlagSet<Count> made;
+			if (declared.size() != Count)
+				throw std::logic_error("A set of " + std::to_string(Count) + " flags was declared with " + std::to_string(declared.size()));
+			if (parent->singleton().initialisationState == INITIALISING) {
+				for (const auto& it : declared)
+					Grabber<DummyValidator>(parent, it.name.empty() ? "" : "--" + it.name, it.shortcut, it.help, DummyValidator{})
+							.registerSwitch(false);
+				return made;
+			}
+
+			// They were registered together, so their values are next to each other
+			if (Count == 0)
+				return made;
+			const int first = switchIndex(declared[0].name.empty() ? "" : "--" + declared[0].name, declared[0].shortcut);
+			if (first < 0 || first + Count > parent->_resolved.size())
+				return made;
+			for (size_t i = 0; i < Count; i++)
+				made.set(i, parent->_resolved[first + i].size());
+			return made;
+		}
+	};
+
+	// Declares a group of boolean switches with values stored in a FlagSet
+	FlagGrabber flags(std::initializer_list<QuickArgParserInternals::Flag> declared) {
+		return FlagGrabber(this, declared);
+	}
+
 	template <typename Validator>
 	class ArgGrabberBase {
 	protected:
@@ -720,13 +2550,19 @@ protected:
 		const int index;
 		Validator validator;
 		template <typename Value>
-		void validate(const Value& value) const {
-			if (!QuickArgParserInternals::ValidatorUser<Validator>::useValidator(validator, value)) {
-				throw QuickArgParserInternals::ArgumentError("Invalid value of argument " + std::to_string(index));
-			}
+		void validate(const Value& value, bool isDefault = false) const {
+			validate(value, isDefault, std::is_same<Validator, DummyValidator>());
+		}
+		template <typename Value>
+		void validate(const Value&, bool, std::true_type) const {} // Avoids making the name if there's nothing to validate
+		template <typename Value>
+		void validate(const Value& value, bool isDefault, std::false_type) const {
+			parent->validate(validator, value, std::to_string(index),
+					isDefault ? int(singleton().nullarySwitches.size() + singleton().unarySwitches.size()) + index : -1);
 		}
 	public:
-		ArgGrabberBase(const MainArguments* parent, int index, const Validator& validator) : parent(parent), index(index), validator(validator) {}
+		ArgGrabberBase(const MainArguments* parent, int index, const Validator& validator)
+				: parent(parent), index(index), validator(validator) {}
 	};
 
 	template <typename Default, typename Validator>
@@ -745,12 +2581,11 @@ protected:
 		operator T() const {
 			static_assert(QuickArgParserInternals::ArgConverter<T>::canDo, "Cannot deserialise into this type");
 			if (Base::parent->singleton().initialisationState == INITIALISING) {
-				Base::parent->singleton().argumentCountMax =
-						std::max(Base::parent->singleton().argumentCountMax, Base::index + 1);
+				QuickArgParserInternals::registerArgument(Base::parent->singleton(), Base::index, false);
 				return QuickArgParserInternals::ArgConverter<T>::makeDefault();
 			}
 			if (Base::index >= int(Base::parent->arguments.size())) {
-				Base::validate(defaultValue);
+				Base::validate(defaultValue, true);
 				return defaultValue;
 			}
 			auto obtained = QuickArgParserInternals::ArgConverter<T>::deserialise(
@@ -777,10 +2612,7 @@ protected:
 		operator T() const {
 			static_assert(QuickArgParserInternals::ArgConverter<T>::canDo, "Cannot deserialise into this type");
 			if (Base::parent->singleton().initialisationState == INITIALISING) {
-				Base::parent->singleton().argumentCountMin =
-						std::max(Base::parent->singleton().argumentCountMin, Base::index + 1);
-				Base::parent->singleton().argumentCountMax =
-						std::max(Base::parent->singleton().argumentCountMax, Base::index + 1);
+				QuickArgParserInternals::registerArgument(Base::parent->singleton(), Base::index, true);
 				return QuickArgParserInternals::ArgConverter<T>::makeDefault();
 			}
 			auto obtained = QuickArgParserInternals::ArgConverter<T>::deserialise(Base::parent->arguments[Base::index]);
@@ -792,9 +2624,270 @@ protected:
 		ArgGrabber<NewValidator> validator(const NewValidator& newValidator) {
 			return ArgGrabber<NewValidator>{Base::parent, Base::index, newValidator};
 		}
+		
+		template <typename NewValidator>
+		ArgGrabber<QuickArgParserInternals::Concurrent<NewValidator>> concurrentValidator(const NewValidator& newValidator) {
+			return ArgGrabber<QuickArgParserInternals::Concurrent<NewValidator>>{Base::parent, Base::index,
+					QuickArgParserInternals::Concurrent<NewValidator>{newValidator}};
+		}
 	};
 	
 	ArgGrabber<DummyValidator> argument(int index) {
 		return ArgGrabber<DummyValidator>{this, index, DummyValidator{}};
 	}
 };
+
+// Remembers the recently parsed command lines and returns the same instance if one is parsed again,
+// the class has to declare static constexpr bool cacheable = true to confirm its parsing has no side effects
+template <typename Child>
+class ParseCache {
+	static_assert(QuickArgParserInternals::IsCacheable<Child>::value, "Parsing this class was not declared to be cacheable");
+	QuickArgParserInternals::CacheIndex<> _index;
+
+	static const QuickArgParserInternals::Schema& initialisedSchema() {
+		MainArguments<Child>::initialiseSchema(); // Before any thread parses, see initialiseSchema()
+		return MainArguments<Child>::singleton();
+	}
+
+public:
+	explicit ParseCache(size_t capacity = 1024) : _index(initialisedSchema(), capacity) {}
+
+	// Help and version are printed only when the command line is not found in the cache, errors are not cached
+	std::shared_ptr<const Child> parse(int argc, char** argv) {
+		const QuickArgParserInternals::CacheIndex<>::Key key = _index.makeKey(argc, argv);
+		std::shared_ptr<const void> found = _index.find(key, argc, argv);
+		if (!found)
+			found = _index.insert(key, argc, argv, std::make_shared<const Child>(Child::parse(argc, argv)));
+		return std::static_pointer_cast<const Child>(found);
+	}
+
+	size_t hits() const {
+		return _index.hits();
+	}
+	size_t misses() const {
+		return _index.misses();
+	}
+	size_t size() const {
+		return _index.size();
+	}
+	void clear() {
+		_index.clear();
+	}
+};
+
+#ifdef QUICK_ARG_PARSER_THREADS
+// Keeps the arguments in a file up to date, reading the current version is a single atomic load
+template <typename Child>
+class HotReloadedArguments {
+	const std::string _path;
+	std::string _directory;
+	std::string _fileName;
+	const int _pollInterval;
+	std::function<void(const Child&, const std::vector<std::string>&)> _onChange;
+	std::function<void(const std::exception&)> _onError;
+
+	std::shared_ptr<const Child> _latest; // Accessed through std::atomic_load and std::atomic_store, written by the watcher
+	std::atomic<uint64_t> _generation{0}; // Identifies the latest version, unique among all instances with the same Child
+
+	// Each thread keeps the version it last read alive, so it can be read without locking until the generation changes
+	struct ReaderCache {
+		uint64_t generation = 0;
+		std::shared_ptr<const Child> version;
+	};
+	static ReaderCache& readerCache() {
+		static thread_local ReaderCache cache;
+		return cache;
+	}
+	static uint64_t nextGeneration() {
+		static std::atomic<uint64_t> generations(0);
+		return ++generations;
+	}
+
+	void publish(std::shared_ptr<const Child> version) {
+		std::atomic_store(&_latest, std::move(version));
+		_generation.store(nextGeneration(), std::memory_order_release);
+	}
+	long long int _lastModified = 0; // In nanoseconds where available
+	long long int _lastSize = 0;
+
+	std::mutex _stopMutex;
+	std::condition_variable _stopCondition;
+	bool _stopping = false;
+	int _wakeUpPipe[2] = { -1, -1 };
+	int _notifications = -1;
+	std::thread _watcher;
+
+	std::shared_ptr<const Child> parse() const {
+		std::string contents;
+		if (!QuickArgParserInternals::readFile(_path, contents))
+			throw QuickArgParserInternals::ArgumentError("Cannot read " + _path);
+		std::vector<std::string> tokens = QuickArgParserInternals::splitCommandLine(contents);
+		tokens.insert(tokens.begin(), _path);
+		std::vector<char*> argv;
+		for (auto& it : tokens)
+			argv.push_back(&it[0]);
+		typename MainArguments<Child>::SpecialOptionsRejection rejection; // Help and version in the file are errors
+		return std::shared_ptr<const Child>(QuickArgParserInternals::constructArguments<Child>(int(argv.size()), argv.data()));
+	}
+
+	bool modified() {
+		struct stat status;
+		if (stat(_path.c_str(), &status) != 0)
+			return false;
+		// Whole seconds would miss a rewrite to the same size within the same second
+#if defined(__APPLE__)
+		const long long int modifiedAt = status.st_mtimespec.tv_sec * 1000000000LL + status.st_mtimespec.tv_nsec;
+#elif defined(_WIN32)
+		const long long int modifiedAt = status.st_mtime * 1000000000LL;
+#else
+		const long long int modifiedAt = status.st_mtim.tv_sec * 1000000000LL + status.st_mtim.tv_nsec;
+#endif
+		if (modifiedAt == _lastModified && status.st_size == _lastSize)
+			return false;
+		_lastModified = modifiedAt;
+		_lastSize = status.st_size;
+		return true;
+	}
+
+	void reload() {
+		modified();
+		try {
+			std::shared_ptr<const Child> made = parse();
+			std::vector<std::string> changed = made->changedOptions(*_latest);
+			if (changed.empty() && made->arguments == _latest->arguments)
+				return;
+			publish(made);
+			if (_onChange)
+				_onChange(*made, changed);
+		} catch (std::exception& error) {
+			// The previous version remains in use
+			if (_onError)
+				_onError(error);
+		}
+	}
+
+	void startWatching() {
+#ifdef __linux__
+		if (pipe(_wakeUpPipe) != 0) {
+			_wakeUpPipe[0] = _wakeUpPipe[1] = -1;
+			return;
+		}
+		_notifications = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		// The directory is watched because editors often replace the file instead of writing into it
+		if (_notifications >= 0 && inotify_add_watch(_notifications, _directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+			close(_notifications);
+			_notifications = -1;
+		}
+#endif
+	}
+
+	void stopWatching() {
+#ifdef __linux__
+		if (_notifications >= 0)
+			close(_notifications);
+		if (_wakeUpPipe[0] >= 0) {
+			close(_wakeUpPipe[0]);
+			close(_wakeUpPipe[1]);
+		}
+#endif
+	}
+
+	void watch() {
+#ifdef __linux__
+		if (_notifications >= 0) {
+			while (true) {
+				pollfd waited[2] = { { _notifications, POLLIN, 0 }, { _wakeUpPipe[0], POLLIN, 0 } };
+				if (poll(waited, 2, -1) < 0 || waited[1].revents)
+					break;
+				alignas(inotify_event) char buffer[4096];
+				bool relevant = false;
+				ssize_t length = 0;
+				while ((length = read(_notifications, buffer, sizeof(buffer))) > 0) {
+					for (char* position = buffer; position < buffer + length; ) {
+						const inotify_event* event = reinterpret_cast<const inotify_event*>(position);
+						if (event->len > 0 && _fileName == event->name)
+							relevant = true;
+						position += sizeof(inotify_event) + event->len;
+					}
+				}
+				if (relevant)
+					reload();
+			}
+			return;
+		}
+#endif
+		// Polling, the file is reloaded only after it stops changing to avoid reading it while it's being written
+		bool changing = false;
+		std::unique_lock<std::mutex> lock(_stopMutex);
+		while (!_stopCondition.wait_for(lock, std::chrono::milliseconds(_pollInterval), [this] { return _stopping; })) {
+			lock.unlock();
+			if (modified())
+				changing = true;
+			else if (changing) {
+				changing = false;
+				reload();
+			}
+			lock.lock();
+		}
+	}
+
+public:
+	// Intervals are in milliseconds
+	HotReloadedArguments(const std::string& path,
+			std::function<void(const Child&, const std::vector<std::string>&)> onChange = nullptr,
+			std::function<void(const std::exception&)> onError = nullptr, int pollInterval = 1000)
+			: _path(path), _pollInterval(pollInterval), _onChange(onChange), _onError(onError) {
+		const auto lastSlash = _path.find_last_of('/');
+		_directory = (lastSlash == std::string::npos) ? "." : _path.substr(0, lastSlash + 1);
+		_fileName = (lastSlash == std::string::npos) ? _path : _path.substr(lastSlash + 1);
+
+		// The file is watched before its initial version is read, otherwise a change in between would be missed
+		startWatching();
+		// Errors in the initial version are reported by throwing
+		try {
+			modified();
+			publish(parse());
+		} catch (...) {
+			stopWatching();
+			throw;
+		}
+		_watcher = std::thread([this] { watch(); });
+	}
+	HotReloadedArguments(const HotReloadedArguments&) = delete;
+	HotReloadedArguments& operator=(const HotReloadedArguments&) = delete;
+
+	~HotReloadedArguments() {
+		{
+			std::lock_guard<std::mutex> lock(_stopMutex);
+			_stopping = true;
+		}
+		_stopCondition.notify_all();
+#ifdef __linux__
+		if (_wakeUpPipe[1] >= 0 && write(_wakeUpPipe[1], "", 1) < 0) {}
+#endif
+		_watcher.join();
+		stopWatching();
+	}
+
+	// The reference remains valid until the thread calls get() again, only one atomic load is needed if nothing changed
+	const Child& get() const {
+		ReaderCache& cache = readerCache();
+		const uint64_t generation = _generation.load(std::memory_order_acquire);
+		if (cache.generation != generation) {
+			cache.version = std::atomic_load(&_latest);
+			cache.generation = generation;
+		}
+		return *cache.version;
+	}
+	// Keeps the latest version alive for as long as needed
+	std::shared_ptr<const Child> share() const {
+		return std::atomic_load(&_latest);
+	}
+	const Child& operator*() const {
+		return get();
+	}
+	const Child* operator->() const {
+		return &get();
+	}
+};
+#endif
\ No newline at end of file
@@ -0,0 +1,37 @@
+//usr/bin/true; for m in "" -DQUICK_ARG_PARSER_SEPARATE_COMPILATION; do s=`date +%s%N`; for i in 1 2 3 4 5 6 7 8 9 10; do g++ --std=c++17 $m -c $0 -o /dev/null || exit 1; done; echo "${m:-header only}: $(( (`date +%s%N` - s) / 10000000 )) ms per translation unit"; done; exit
+// Measures how long it takes to compile a translation unit declaring a few typical argument structs
+#include "quick_arg_parser.hpp"
+
+struct ServerArgs : MainArguments<ServerArgs> {
+	using MainArguments<ServerArgs>::MainArguments;
+	bool verbose = option("verbose", 'v');
+	int port = option("port", 'p', "Port to listen on") = 8080;
+	unsigned int workers = option("workers", 'w') = 4;
+	double timeout = option("timeout", 't') = 1.5;
+	std::string root = argument(0) = ".";
+};
+
+struct ClientArgs : MainArguments<ClientArgs> {
+	using MainArguments<ClientArgs>::MainArguments;
+	std::vector<int> ports = option("ports", 'p');
+	std::vector<std::string> hosts = option("hosts", 'h');
+	long int retries = option("retries", 'r') = 3;
+	float backoff = option("backoff", 'b').validator([] (float backoff) { return backoff >= 0; }) = 0.5;
+	std::string target = argument(0);
+};
+
+struct ToolArgs : MainArguments<ToolArgs> {
+	using MainArguments<ToolArgs>::MainArguments;
+	bool dryRun = option("dry_run", 'n');
+	bool force = option("force", 'f');
+	int level = option("level", 'l') = 1;
+	std::string input = argument(0);
+	std::string output = argument(1) = "out";
+};
+
+int main(int argc, char** argv) {
+	ServerArgs server{argc, argv};
+	ClientArgs client{argc, argv};
+	ToolArgs tool{argc, argv};
+	return server.port + client.retries + tool.level;
+}
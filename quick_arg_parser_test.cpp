@@ -1,5 +1,12 @@
 //usr/bin/g++ --std=c++11 -Wall $0 -o ${o=`mktemp`} && exec $o $*
+// Separate compilation: g++ --std=c++11 -Wall -DQUICK_ARG_PARSER_SEPARATE_COMPILATION quick_arg_parser_test.cpp quick_arg_parser.cpp
+// Without iostreams in the library: g++ --std=c++11 -Wall -DQUICK_ARG_PARSER_NO_IOSTREAM quick_arg_parser_test.cpp
 #include "quick_arg_parser.hpp"
+#include <iostream>
+#include <atomic>
+#ifdef QUICK_ARG_PARSER_THREADS
+#include <fstream>
+#endif
 
 struct Input : MainArguments<Input> {
 	using MainArguments<Input>::MainArguments; // Not necessary in C++17
@@ -74,8 +81,120 @@ struct Input5 : MainArguments<Input5> {
 	Optional<int> logPort = option("logPort", 'l');
 };
 
-template <typename T>
-T constructFromString(std::string args) {
+struct Input7 : MainArguments<Input7> {
+	using MainArguments<Input7>::MainArguments;
+	std::vector<int> ports = option("ports", 'p');
+	std::unordered_map<std::string, int> weights = option("weights", 'w');
+	bool verbose = option("verbose", 'v');
+
+	static ParsingLimits limits() {
+		ParsingLimits limits;
+		limits.maxTokens = 4;
+		limits.maxTokenLength = 16;
+		limits.maxTotalBytes = 30;
+		limits.maxListElements = 3;
+		return limits;
+	}
+};
+
+struct Input8 : MainArguments<Input8> {
+	using MainArguments<Input8>::MainArguments;
+	Hex<std::vector<uint8_t>> salt = option("salt", 's');
+	Base64<std::vector<uint8_t>> bitmap = option("bitmap", 'b');
+	Hex<std::array<uint8_t, 4>> key = option("key", 'k');
+	std::vector<uint8_t> numbers = option("numbers", 'n');
+};
+
+std::atomic<int> defaultValidations(0);
+
+struct Input9 : MainArguments<Input9> {
+	using MainArguments<Input9>::MainArguments;
+	int first = option("first", 'f').concurrentValidator([] (int first) { return first > 0; }) = 1;
+	int second = option("second", 's').concurrentValidator([] (int second) {
+		if (second > 10)
+			throw QuickArgParserInternals::ArgumentError("Second is too large");
+	}) = 2;
+	std::string path = argument(0).concurrentValidator([] (const std::string& path) {
+		defaultValidations++;
+		return !path.empty();
+	}) = "default";
+};
+
+struct Input11 : MainArguments<Input11> {
+	using MainArguments<Input11>::MainArguments;
+	int port = option("port", 'p').environment("QAP_TEST_PORT") = 80;
+	std::vector<int> ids = option("ids", 'i').environment("QAP_TEST_IDS");
+	bool verbose = option("verbose", 'v').environment("QAP_TEST_VERBOSE");
+	bool quiet = option("quiet", 'q').environment("QAP_TEST_QUIET");
+	std::string host = option("host", 'h').environment("QAP_TEST_HOST") = "localhost";
+
+	void onHelp() {}
+};
+
+int cachedValidations = 0;
+
+struct Input12 : MainArguments<Input12> {
+	using MainArguments<Input12>::MainArguments;
+	static constexpr bool cacheable = true;
+	int level = option("level", 'l').validator([] (int) { cachedValidations++; return true; }) = 1;
+	std::string file = argument(0) = "";
+	std::string mode = option("mode", 'm').environment("QAP_TEST_MODE") = "fast";
+};
+
+enum Switch { VERBOSE, DRY_RUN, FORCE, QUIET };
+
+struct Input13 : MainArguments<Input13> {
+	using MainArguments<Input13>::MainArguments;
+	int level = option("level", 'l') = 0;
+	FlagSet<4> switches = flags({{"verbose", 'v', "More output"}, {"dry_run", 'n'}, {"force", 'f'}, {"", 'q'}});
+	bool other = option("other", 'o');
+};
+
+std::string printed;
+
+struct Input10 : MainArguments<Input10> {
+	using MainArguments<Input10>::MainArguments;
+	int count = option("count", 'c') = 1;
+
+	static std::string version() {
+		return "2.1";
+	}
+	static void output(const std::string& text) {
+		printed += text;
+	}
+	void onHelp() {}
+	void onVersion() {}
+};
+
+#if __cplusplus >= 201402L
+enum class Shape { CIRCLE, SQUARE, TRIANGLE, HEXAGON };
+enum Feature : unsigned int { FAST = 1, SAFE = 2, LOUD = 4, SHINY = 8 };
+
+namespace QuickArgParserInternals {
+template <>
+struct EnumNames<Shape> {
+	static constexpr std::array<EnumName<Shape>, 4> names() {
+		return {{{"circle", Shape::CIRCLE}, {"square", Shape::SQUARE}, {"triangle", Shape::TRIANGLE}, {"hexagon", Shape::HEXAGON}}};
+	}
+};
+template <>
+struct EnumNames<Feature> {
+	static constexpr std::array<EnumName<Feature>, 4> names() {
+		return {{{"fast", FAST}, {"safe", SAFE}, {"loud", LOUD}, {"shiny", SHINY}}};
+	}
+};
+} // namespace
+
+struct Input6 : MainArguments<Input6> {
+	using MainArguments<Input6>::MainArguments;
+	Shape shape = option("shape", 's');
+	Shape fill = option("fill", 'f') = Shape::SQUARE;
+	EnumFlags<Feature> features = option("features", 'F');
+	std::vector<Shape> extra = option("extra", 'e');
+};
+#endif
+
+std::vector<char*> splitInPlace(std::string& args) {
 	std::vector<char*> segments;
 	segments.push_back(&args[0]);
 	for (int i = 0; i < int(args.size()); i++) {
@@ -84,9 +203,30 @@ T constructFromString(std::string args) {
 			args[i] = '\0';
 		}
 	}
+	return segments;
+}
+
+template <typename T>
+T constructFromString(std::string args) {
+	std::vector<char*> segments = splitInPlace(args);
 	return T{int(segments.size()), &segments[0]};
 }
 
+template <typename T>
+T parseFromString(std::string args) {
+	std::vector<char*> segments = splitInPlace(args);
+	return T::parse(int(segments.size()), &segments[0]);
+}
+
+struct OutputClassifier {
+	bool takesValue(Token& token) const {
+		return token.name == "-o" || token.name == "o";
+	}
+	size_t nonstandardLength(const char* arg) const {
+		return std::strncmp(arg, "-o", 2) == 0 && (arg[2] == '\0' || arg[2] == '=') ? 2 : 0;
+	}
+};
+
 int errors = 0;
 
 template <typename T1, typename T2>
@@ -154,5 +294,325 @@ int main() {
 	verify(t5.parts, 3);
 	verify(bool(t5.logPort), false);
 
+	std::cout << "Reloaded input" << std::endl;
+	std::vector<std::string> split = QuickArgParserInternals::splitCommandLine("-V --port 667 # comment\n\"a \\\"b\\\"\" c\\ d 'e f'\n");
+	verify(int(split.size()), 6);
+	if (int(split.size()) == 6) {
+		verify(split[3], "a \"b\"");
+		verify(split[4], "c d");
+		verify(split[5], "e f");
+	}
+	Input t6 = constructFromString<Input>("super_program -V --port 667 -- 3");
+	std::vector<std::string> changed = t6.changedOptions(t1);
+	verify(int(changed.size()), 1);
+	if (int(changed.size()) == 1)
+		verify(changed[0], "--port");
+#ifdef QUICK_ARG_PARSER_THREADS
+	{
+		const char* reloadedPath = "quick_arg_parser_reloaded.conf";
+		std::ofstream(reloadedPath) << "-V --port 667\n";
+		std::mutex reloadMutex;
+		std::condition_variable reloadCondition;
+		std::vector<std::string> reloadChanged;
+		int reloadErrors = 0;
+		HotReloadedArguments<Input> reloaded(reloadedPath, [&] (const Input&, const std::vector<std::string>& changed) {
+			std::lock_guard<std::mutex> lock(reloadMutex);
+			reloadChanged = changed;
+			reloadCondition.notify_all();
+		}, [&] (const std::exception&) {
+			std::lock_guard<std::mutex> lock(reloadMutex);
+			reloadErrors++;
+			reloadCondition.notify_all();
+		}, 50);
+		const Input& firstRead = reloaded.get();
+		verify(firstRead.port, 667);
+		std::weak_ptr<const Input> firstVersion = reloaded.share();
+		auto awaitReload = [&] (const std::string& contents, const std::function<bool()>& done) {
+			std::ofstream(reloadedPath) << contents;
+			std::unique_lock<std::mutex> lock(reloadMutex);
+			return reloadCondition.wait_for(lock, std::chrono::seconds(5), done);
+		};
+		verify(awaitReload("-V --port 668 --logPort 3\n", [&] { return !reloadChanged.empty(); }), true);
+		verify(firstRead.port, 667); // Kept alive until this thread reads again
+		verify(reloaded->port, 668);
+		verify(firstVersion.expired(), true);
+		verify(*reloaded->logPort, 3);
+		verify(int(reloadChanged.size()), 2);
+		if (reloadChanged.size() == 2) {
+			verify(reloadChanged[0], "--port");
+			verify(reloadChanged[1], "--logPort");
+		}
+		verify(awaitReload("--help\n", [&] { return reloadErrors > 0; }), true); // Must not exit the program
+		verify(reloaded->port, 668);
+		{
+			std::lock_guard<std::mutex> lock(reloadMutex);
+			reloadChanged.clear();
+		}
+		verify(awaitReload("-p 669\n", [&] { return !reloadChanged.empty(); }), true);
+		verify(reloaded->port, 669);
+		std::remove(reloadedPath);
+	}
+#endif
+
+	std::cout << "Snapshot input" << std::endl;
+	Input2 t7{t2.snapshot()};
+	verify(int(t7.ports.size()), 4);
+	verify(t7.file, "-lame_file_name");
+	verify(bool(t7.downloads), false);
+	verify(*t7.uploads, 3);
+	verify(t7.logFile, "log");
+	verify(t7.debugLogFile, "debug.log");
+	verify(*t7.logAddress, "127.0.0.1");
+	verify(t7.legacyOption, 2);
+	verify(int(t7.changedOptions(t2).size()), 0);
+	std::string canonical;
+	for (const std::string& it : t4.canonicalCommandLine())
+		canonical += (canonical.empty() ? "" : " ") + it;
+	verify(canonical, "ultimate_program --mute_neighbours --jam_phones --connectors=5 --connectors=8 --connectors=10 --genre=punk "
+			"--master_volume=110 --speaker_volumes=left=110 --speaker_volumes=right=105,bottom=115 -- ~/Music");
+	Input4 t8 = constructFromString<Input4>(canonical);
+	verify(int(t8.changedOptions(t4).size()), 0);
+	verify(t8.path, t4.path);
+	try {
+		Input t9{t2.snapshot()};
+		verify("Snapshot of different options", "accepted");
+	} catch (QuickArgParserInternals::ArgumentError&) {}
+
+	std::cout << "Limited input" << std::endl;
+	Input7 t11 = constructFromString<Input7>("limited_program -p 1,2 -p3 -v");
+	verify(int(t11.ports.size()), 3);
+	for (const char* excessive : { "limited_program -v -v -v -v -v", "limited_program -p 1,2,3,4",
+			"limited_program -wa=1,b=2 -wc=3,d=4", "limited_program --weights=first=1,second=2",
+			"limited_program -p 1111111111 -p 2222222222 -p 3333333333" }) {
+		try {
+			constructFromString<Input7>(excessive);
+			verify(excessive, "accepted");
+		} catch (QuickArgParserInternals::LimitError&) {}
+	}
+
+	std::cout << "Concurrently validated input" << std::endl;
+	Input9 t13 = parseFromString<Input9>("validated_program -f 3");
+	verify(t13.first, 3);
+	verify(t13.path, "default");
+	Input9 t14 = parseFromString<Input9>("validated_program -s 4");
+	verify(t14.second, 4);
+	verify(int(defaultValidations), 1);
+	Input9 t15 = parseFromString<Input9>("validated_program path");
+	verify(t15.path, "path");
+	verify(int(defaultValidations), 2);
+	try {
+		parseFromString<Input9>("validated_program -f 0 -s 11");
+		verify("Invalid values", "accepted");
+	} catch (QuickArgParserInternals::ArgumentError& error) {
+		verify(std::string(error.what()), "Invalid value of argument --first; Second is too large");
+	}
+	try {
+		constructFromString<Input9>("validated_program -f 0 -s 11");
+		verify("Invalid value", "accepted");
+	} catch (QuickArgParserInternals::ArgumentError& error) {
+		verify(std::string(error.what()), "Invalid value of argument --first");
+	}
+
+	std::cout << "Binary input" << std::endl;
+	Input8 t12 = constructFromString<Input8>("binary_program -s 000102030405060708090a0B0c0D0e0F10111213 "
+			"--bitmap=AAECAwQFBgcICQoLDA0ODxAREhMUFRYX/w== -k cafeF00D -n 1,2");
+	verify(int(t12.salt.size()), 20);
+	for (int i = 0; i < int(t12.salt.size()); i++)
+		verify(int(t12.salt[i]), i);
+	verify(int(t12.bitmap.size()), 25);
+	for (int i = 0; i < int(t12.bitmap.size()) - 1; i++)
+		verify(int(t12.bitmap[i]), i);
+	verify(int(t12.bitmap.back()), 255);
+	verify(int(t12.key[0]), 0xca);
+	verify(int(t12.key[3]), 0x0d);
+	verify(int(t12.numbers.size()), 2);
+	for (const char* invalid : { "binary_program -s 0g", "binary_program -s 012", "binary_program -k cafe",
+			"binary_program -b AAECAwQFBgcICQoLDA0ODxAREhMUFR!X/w==", "binary_program -b AB=C" }) {
+		try {
+			constructFromString<Input8>(invalid);
+			verify(invalid, "accepted");
+		} catch (QuickArgParserInternals::ArgumentError&) {}
+	}
+
+	std::cout << "Redirected output" << std::endl;
+	Input10 t16 = constructFromString<Input10>("quiet_program -V --help -c 3");
+	verify(t16.count, 3);
+	verify(printed.substr(0, 4), "2.1\n");
+	verify(printed.find("--count") != std::string::npos, true);
+
+	std::cout << "Input from environment" << std::endl;
+	static char portVariable[] = "QAP_TEST_PORT=4000";
+	static char idsVariable[] = "QAP_TEST_IDS=1,2,3";
+	static char verboseVariable[] = "QAP_TEST_VERBOSE=Yes";
+	static char quietVariable[] = "QAP_TEST_QUIET=Off";
+	putenv(portVariable);
+	putenv(idsVariable);
+	putenv(verboseVariable);
+	putenv(quietVariable);
+	Input11 t17 = constructFromString<Input11>("env_program -p 5000");
+	verify(t17.port, 5000);
+	verify(int(t17.ids.size()), 3);
+	verify(t17.verbose, true);
+	verify(t17.quiet, false);
+	verify(t17.host, "localhost");
+	Input11 t18 = constructFromString<Input11>("env_program --ids=7");
+	verify(t18.port, 4000);
+	verify(int(t18.ids.size()), 1);
+
+	std::cout << "Batch input" << std::endl;
+	std::vector<std::string> batch = {"program -p 1", "program --port=2 -VV 5", "program --nonsense", "program -p 4"};
+	for (int i = 0; i < 20; i++)
+		batch.push_back("program -p " + std::to_string(i + 10));
+	auto parsedBatch = Input5::parseBatch(batch);
+	verify(int(parsedBatch.size()), 24);
+	if (parsedBatch.size() == 24) {
+		verify(parsedBatch[1].parsed->port, 2);
+		verify(int(parsedBatch[1].parsed->verbose.size()), 2);
+		verify(parsedBatch[1].parsed->parts, 5);
+		verify(bool(parsedBatch[2].parsed), false);
+		verify(parsedBatch[2].error, "Unknown switch --nonsense");
+		verify(parsedBatch[23].parsed->port, 29);
+	}
+	auto parsedTokens = Input5::parseBatch(std::vector<std::vector<std::string>>{{"program", "-p", "7"}, {}});
+	verify(parsedTokens[0].parsed->port, 7);
+	verify(parsedTokens[1].error.empty(), false);
+	auto parsedSpecial = Input5::parseBatch(std::vector<std::string>{"program --help", "program -p 3 -?"});
+	verify(parsedSpecial[0].error, "Help cannot be printed here");
+	verify(bool(parsedSpecial[1].parsed), false);
+	auto parsedVersion = Input3::parseBatch(std::vector<std::string>{"program file --version"});
+	verify(parsedVersion[0].error, "Version cannot be printed here");
+
+	std::cout << "Cached input" << std::endl;
+	ParseCache<Input12> cache(2);
+	auto parseCached = [&] (std::string args) {
+		std::vector<char*> segments = splitInPlace(args);
+		return cache.parse(int(segments.size()), &segments[0]);
+	};
+	auto cached1 = parseCached("cached_program -l 3 a");
+	auto cached2 = parseCached("cached_program -l 3 a");
+	verify(cached1.get(), cached2.get());
+	verify(cached2->level, 3);
+	verify(cachedValidations, 1);
+	parseCached("cached_program -l 4 b");
+	parseCached("cached_program -l 5 c"); // Evicts the least recently used one
+	verify(int(cache.size()), 2);
+	auto cached3 = parseCached("cached_program -l 3 a");
+	verify(cached3->file, "a");
+	verify(cached1.get() != cached3.get(), true);
+	verify(int(cache.hits()), 1);
+	verify(int(cache.misses()), 4);
+	static char modeVariable[] = "QAP_TEST_MODE=slow";
+	putenv(modeVariable);
+	auto cached4 = parseCached("cached_program -l 3 a");
+	verify(cached4->mode, "slow");
+	verify(cached3->mode, "fast");
+	verify(int(cache.misses()), 5);
+
+	std::cout << "Flag input" << std::endl;
+	Input13 t19 = constructFromString<Input13>("flag_program -vvnl 3 --verbose -o");
+	verify(t19.switches[VERBOSE], true);
+	verify(t19.switches.count(VERBOSE), 3);
+	verify(t19.switches[DRY_RUN], true);
+	verify(t19.switches[FORCE], false);
+	verify(t19.switches[QUIET], false);
+	verify(int(t19.switches.setCount()), 2);
+	verify(t19.level, 3);
+	verify(t19.other, true);
+	Input13 t20 = constructFromString<Input13>("flag_program -q");
+	verify(t20.switches[QUIET], true);
+	verify(t20.switches.any(), true);
+	verify(t20.other, false);
+
+	std::cout << "Early input" << std::endl;
+	{
+		std::string line = "server -t8 --log-level=debug -vv --numa-node 1 file -- --threads=3";
+		std::vector<char*> segments = splitInPlace(line);
+		EarlyArguments early(int(segments.size()), &segments[0]);
+		verify(early.option<int>("threads", 't', 1), 8);
+		verify(early.option<std::string>("log-level", 'L', "info"), "debug");
+		verify(early.option<int>("numa-node", '\0', 0), 1);
+		verify(early.option<int>("cores", 'c', 4), 4);
+		verify(early.has("verbose", 'v'), true);
+		verify(early.has("quiet", 'q'), false);
+
+		std::string fullLine = "server -p 8 -VV 5";
+		std::vector<char*> fullSegments = splitInPlace(fullLine);
+		EarlyArguments earlyFull(int(fullSegments.size()), &fullSegments[0]);
+		verify(earlyFull.option<int>(nullptr, 'p', 0), 8);
+		Input5 t21(earlyFull);
+		verify(t21.port, 8);
+		verify(int(t21.verbose.size()), 2);
+		verify(t21.parts, 5);
+	}
+
+	std::cout << "Tokenized input" << std::endl;
+	{
+		std::string line = "tool -xvf archive --level=3 --dry file -o out -- -x";
+		std::vector<char*> segments = splitInPlace(line);
+		std::string seen;
+		Tokenizer<> tokenizer(int(segments.size()), &segments[0]);
+		for (const Token& token : tokenizer) {
+			seen += token.kind == Token::POSITIONAL ? "(" + token.value.str() + ")" : token.name.str();
+			if (token.kind != Token::POSITIONAL && token.hasValue)
+				seen += "=" + token.value.str();
+			seen += ' ';
+		}
+		verify(seen, "x v f (archive) --level=3 --dry (file) o (out) -- (-x) ");
+		std::string seenClassified;
+		Tokenizer<OutputClassifier> classified(int(segments.size()), &segments[0]);
+		Token token;
+		while (classified.next(token)) {
+			if (token.hasValue && token.kind != Token::POSITIONAL)
+				seenClassified += token.name.str() + "=" + token.value.str() + "@" + std::to_string(token.index) + " ";
+		}
+		verify(seenClassified, "--level=3@3 -o=out@6 ");
+	}
+	{
+		std::string line = "tool -xo= file";
+		std::vector<char*> segments = splitInPlace(line);
+		Tokenizer<OutputClassifier> tokenizer(int(segments.size()), &segments[0]);
+		Token token;
+		tokenizer.next(token);
+		tokenizer.next(token);
+		verify(token.hasValue && token.value.size == 0, true);
+		tokenizer.next(token);
+		verify(token.kind == Token::POSITIONAL, true);
+	}
+	Input4 t22 = constructFromString<Input4>("ultimate_program -g= file");
+	verify(t22.genre, "");
+	verify(t22.path, "file");
+	try {
+		constructFromString<Input5>("program --port");
+		verify("Missing value", "accepted");
+	} catch (QuickArgParserInternals::ArgumentError& error) {
+		verify(std::string(error.what()), "Switch --port requires a value");
+	}
+	try {
+		constructFromString<Input5>("program --extra=1");
+		verify("Value of nullary switch", "accepted");
+	} catch (QuickArgParserInternals::ArgumentError&) {}
+
+#if __cplusplus >= 201402L
+	std::cout << "Enum input" << std::endl;
+	Input6 t10 = constructFromString<Input6>("enum_program -s triangle --features fast,loud -F shiny -e circle,hexagon");
+	verify(int(t10.shape), int(Shape::TRIANGLE));
+	verify(int(t10.fill), int(Shape::SQUARE));
+	verify(t10.features.bits(), FAST | LOUD | SHINY);
+	verify(t10.features.has(SAFE), false);
+	verify(int(t10.extra.size()), 2);
+	if (int(t10.extra.size()) == 2)
+		verify(int(t10.extra[1]), int(Shape::HEXAGON));
+	try {
+		constructFromString<Input6>("enum_program -s pentagon");
+		verify("Invalid enum value", "accepted");
+	} catch (QuickArgParserInternals::ArgumentError& error) {
+		verify(std::string(error.what()), "Invalid value pentagon, expected one of: circle, square, triangle, hexagon");
+	}
+	try {
+		constructFromString<Input6>("enum_program -F fast,slow");
+		verify("Invalid enum flag", "accepted");
+	} catch (QuickArgParserInternals::ArgumentError&) {}
+#endif
+
 	std::cout << "Errors: " << errors << std::endl;
 }